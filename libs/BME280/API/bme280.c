@@ -414,7 +414,7 @@ int8_t bme280_get_regs(uint8_t reg_addr, uint8_t *reg_data, uint16_t len, const
         }
 
         /* Read the data  */
-        rslt = dev->read(dev->dev_id, reg_addr, reg_data, len);
+        rslt = dev->read(dev->dev_id, reg_addr, reg_data, len, dev->intf_ptr);
 
         /* Check for communication error */
         if (rslt != BME280_OK)
@@ -474,7 +474,7 @@ int8_t bme280_set_regs(uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len,
             {
                 temp_len = len;
             }
-            rslt = dev->write(dev->dev_id, reg_addr[0], temp_buff, temp_len);
+            rslt = dev->write(dev->dev_id, reg_addr[0], temp_buff, temp_len, dev->intf_ptr);
 
             /* Check for communication error */
             if (rslt != BME280_OK)
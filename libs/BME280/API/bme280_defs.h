@@ -252,7 +252,7 @@ enum bme280_intf {
 /*!
  * @brief Type definitions
  */
-typedef int8_t (*bme280_com_fptr_t)(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len);
+typedef int8_t (*bme280_com_fptr_t)(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len, void *intf_ptr);
 typedef void (*bme280_delay_fptr_t)(uint32_t period);
 
 /*!
@@ -370,6 +370,9 @@ struct bme280_dev
     /*! SPI/I2C interface */
     enum bme280_intf intf;
 
+    /*! Interface context passed to read/write functions (e.g. bus of the device) */
+    void *intf_ptr;
+
     /*! Read function pointer */
     bme280_com_fptr_t read;
 
@@ -0,0 +1,95 @@
+
+#include "bme280_lib.h"
+
+// (p / 1013.25 hPa) ^ 0.190263 in Q30 from ALT_TABLE_MIN in steps of 2^16 (655.36 Pa)
+#define ALT_TABLE_MIN 3000000
+#define ALT_TABLE_SHIFT 16
+#define ALT_TABLE_MAX (ALT_TABLE_MIN + 122 * (1UL << ALT_TABLE_SHIFT) + 0xFFFF)
+
+// temperature of the standard atmosphere at the reference / lapse rate, 288.15 K / 6.5 K/km [mm]
+#define ALT_SCALE_MM 44330770LL
+
+static const int32_t alt_table[125] = {
+  851780574, 855289974, 858739140, 862130334, 865465690, 868747222, 871976834, 875156326,
+  878287404, 881371685, 884410704, 887405920, 890358718, 893270418, 896142278, 898975495,
+  901771212, 904530521, 907254465, 909944041, 912600204, 915223866, 917815905, 920377158,
+  922908432, 925410499, 927884103, 930329957, 932748746, 935141132, 937507751, 939849213,
+  942166110, 944459009, 946728460, 948974991, 951199113, 953401321, 955582091, 957741883,
+  959881143, 962000303, 964099780, 966179978, 968241288, 970284089, 972308748, 974315622,
+  976305056, 978277386, 980232935, 982172021, 984094950, 986002019, 987893518, 989769729,
+  991630924, 993477370, 995309325, 997127042, 998930764, 1000720731, 1002497175, 1004260322,
+  1006010393, 1007747602, 1009472158, 1011184267, 1012884126, 1014571930, 1016247868, 1017912126,
+  1019564883, 1021206316, 1022836597, 1024455894, 1026064370, 1027662186, 1029249498, 1030826460,
+  1032393222, 1033949929, 1035496725, 1037033749, 1038561139, 1040079028, 1041587548, 1043086826,
+  1044576989, 1046058159, 1047530457, 1048994000, 1050448905, 1051895284, 1053333247, 1054762905,
+  1056184363, 1057597725, 1059003094, 1060400571, 1061790253, 1063172237, 1064546618, 1065913489,
+  1067272940, 1068625061, 1069969941, 1071307664, 1072638316, 1073961980, 1075278736, 1076588666,
+  1077891847, 1079188357, 1080478272, 1081761667, 1083038613, 1084309185, 1085573451, 1086831482,
+  1088083346, 1089329110, 1090568840, 1091802601, 1093030457,
+};
+
+/**
+ * alt_ratio: This function evaluates (p / 1013.25 hPa) ^ 0.190263 by quadratic
+ *                  interpolation of alt_table (pressure is clamped to 300 .. 1100 hPa)
+ * Returns:
+ *    ratio in Q30
+ *
+*/
+static int32_t alt_ratio(uint32_t pressure){
+  uint32_t idx;
+  int32_t t;
+  int32_t d1;
+  int32_t d2;
+
+  if (pressure < ALT_TABLE_MIN)
+    pressure = ALT_TABLE_MIN;
+  else if (pressure > ALT_TABLE_MAX)
+    pressure = ALT_TABLE_MAX;
+
+  idx = (pressure - ALT_TABLE_MIN) >> ALT_TABLE_SHIFT;
+  t = (int32_t)((pressure - ALT_TABLE_MIN) & 0xFFFF);
+
+  // Newton forward differences through points idx .. idx + 2, t in Q16
+  d1 = alt_table[idx + 1] - alt_table[idx];
+  d2 = alt_table[idx + 2] - 2 * alt_table[idx + 1] + alt_table[idx];
+
+  return alt_table[idx] + (int32_t)(((int64_t)d1 * t) >> 16) + \
+         (int32_t)(((int64_t)d2 * (((int64_t)t * (t - 65536)) >> 17)) >> 16);
+
+}
+
+/**
+ * BME280_SetGround: This function sets the reference pressure of BME280_Altitude(...)
+ * Arguments:
+ *    [0] BME280_Ground * ground: pointer to the reference struct
+ *    [1] uint32_t pressure: pressure at the reference (e.g. at launch site, averaged) [0.01 Pa];
+ *          BME280_SEA_LEVEL for altitude above mean sea level of the standard atmosphere
+ *
+*/
+void BME280_SetGround(struct BME280_Ground * ground, uint32_t pressure){
+
+  ground->pressure = pressure;
+  ground->ratio = alt_ratio(pressure);
+  // the only division, done once
+  ground->scale = (int32_t)((ALT_SCALE_MM << 30) / ground->ratio);
+
+}
+
+/**
+ * BME280_Altitude: This function converts pressure to altitude above the reference,
+ *                  h = 44330.77 m * (1 - (p / p0) ^ 0.190263), without pow(...)
+ * Arguments:
+ *    [0] BME280_Ground * ground: pointer to the reference set by BME280_SetGround(...)
+ *    [1] uint32_t pressure: pressure [0.01 Pa] (e.g. BME280_Result)
+ * Returns:
+ *    altitude [mm]
+ * Note:
+ *    (p / p0) ^ 0.190263 equals ratio(p) / ratio(p0) of the table, so any reference is exact;
+ *      it is within 1 cm of the formula over 300 .. 1100 hPa
+ *
+*/
+int32_t BME280_Altitude(const struct BME280_Ground * ground, uint32_t pressure){
+
+  return (int32_t)(((int64_t)(ground->ratio - alt_ratio(pressure)) * ground->scale) >> 30);
+
+}
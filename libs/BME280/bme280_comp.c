@@ -0,0 +1,207 @@
+
+#include "bme280_lib.h"
+
+// limits of the API compensation
+#define COMP_TEMPERATURE_MIN -4000
+#define COMP_TEMPERATURE_MAX 8500
+#define COMP_PRESSURE_MIN (30000 * 16)
+#define COMP_PRESSURE_MAX (110000 * 16)
+#define COMP_HUMIDITY_MAX 102400
+
+/**
+ * BME280_CompInit: This function derives compensation constants from calibration data of the sensor;
+ *                  called by BME280_Start(...) after bme280_init(...) has read them
+ * Arguments:
+ *    [0] BME280_Comp * comp: pointer to the constants struct
+ *    [1] bme280_calib_data * calib: pointer to calibration data (e.g. &sensor->calib_data)
+ *
+*/
+void BME280_CompInit(struct BME280_Comp * comp, const struct bme280_calib_data * calib){
+
+  comp->t1 = calib->dig_t1;
+  comp->t1x2 = (int32_t)calib->dig_t1 * 2;
+  comp->t2 = calib->dig_t2;
+  comp->t3 = calib->dig_t3;
+
+  comp->p1 = calib->dig_p1;
+  comp->p2 = calib->dig_p2;
+  comp->p3 = calib->dig_p3;
+  comp->p4 = (int32_t)calib->dig_p4 * 65536;
+  comp->p5x2 = (int32_t)calib->dig_p5 * 2;
+  comp->p6 = calib->dig_p6;
+  comp->p7 = calib->dig_p7;
+  comp->p8 = calib->dig_p8;
+  comp->p9 = calib->dig_p9;
+
+  comp->h1 = calib->dig_h1;
+  comp->h2 = calib->dig_h2;
+  comp->h3 = calib->dig_h3;
+  comp->h4 = (int32_t)calib->dig_h4 * 1048576;
+  comp->h5 = calib->dig_h5;
+  comp->h6 = calib->dig_h6;
+
+  comp->t_fine = 0;
+
+}
+
+/**
+ * BME280_CompTemperature: This function compensates raw temperature and stores t_fine
+ *                  used by pressure and humidity of the same reading (same result as the API)
+ * Arguments:
+ *    [0] BME280_Comp * comp: pointer to the constants struct
+ *    [1] uint32_t adc_t: raw temperature (bme280_uncomp_data)
+ * Returns:
+ *    temperature [0.01 degC]
+ *
+*/
+int32_t BME280_CompTemperature(struct BME280_Comp * comp, uint32_t adc_t){
+  int32_t var1;
+  int32_t var2;
+  int32_t temperature;
+
+  var1 = ((int32_t)(adc_t / 8) - comp->t1x2) * comp->t2 / 2048;
+  var2 = (int32_t)(adc_t / 16) - comp->t1;
+  var2 = (((var2 * var2) / 4096) * comp->t3) / 16384;
+  comp->t_fine = var1 + var2;
+
+  temperature = (comp->t_fine * 5 + 128) / 256;
+  if (temperature < COMP_TEMPERATURE_MIN)
+    temperature = COMP_TEMPERATURE_MIN;
+  else if (temperature > COMP_TEMPERATURE_MAX)
+    temperature = COMP_TEMPERATURE_MAX;
+
+  return temperature;
+
+}
+
+/**
+ * comp_div: This function divides (num << shift) by den in steps of 4 bits, so that the
+ *                  shifted numerator never overflows (den < 2^28, quotient has to fit)
+ *
+*/
+static uint32_t comp_div(uint32_t num, uint32_t den, uint8_t shift){
+  uint32_t quotient = num / den;
+  uint32_t remainder = num % den;
+  uint8_t step;
+
+  while (shift){
+    step = (shift > 4) ? 4 : shift;
+    quotient = (quotient << step) + (remainder << step) / den;
+    remainder = (remainder << step) % den;
+    shift -= step;
+  }
+
+  return quotient;
+
+}
+
+/**
+ * BME280_CompPressure: This function compensates raw pressure with 32-bit arithmetic only
+ * Arguments:
+ *    [0] BME280_Comp * comp: pointer to the constants struct, after BME280_CompTemperature(...)
+ *    [1] uint32_t adc_p: raw pressure (bme280_uncomp_data)
+ * Returns:
+ *    pressure [0.01 Pa], resolution 1/16 Pa, 300 .. 1100 hPa
+ * Note:
+ *    this is the 32-bit formula of the API with 8 more bits of its divisor and
+ *      the quotient kept in 1/16 Pa; the API one is up to ~6 Pa off the 64-bit formula
+ *
+*/
+uint32_t BME280_CompPressure(const struct BME280_Comp * comp, uint32_t adc_p){
+  int32_t var1;
+  int32_t var2;
+  int32_t var3;
+  int32_t var4;
+  uint32_t scaled;
+  uint32_t divisor;
+  uint32_t pressure;
+  int32_t pressure16;
+
+  var1 = (comp->t_fine / 2) - 64000;
+  var2 = (((var1 / 4) * (var1 / 4)) / 2048) * comp->p6;
+  var2 = var2 + var1 * comp->p5x2;
+  var2 = (var2 / 4) + comp->p4;
+  var3 = (comp->p3 * (((var1 / 4) * (var1 / 4)) / 8192)) / 8;
+  var4 = (comp->p2 * var1) / 2;
+
+  // (32768 + (var3 + var4) / 2^18) * p1 / 32768 of the API, times 256
+  scaled = (uint32_t)(32768 * 256 + (var3 + var4) / 1024);
+  divisor = ((scaled >> 8) * (uint32_t)comp->p1 + (((scaled & 0xFF) * (uint32_t)comp->p1) >> 8)) >> 7;
+
+  // avoid division by zero
+  if (!divisor)
+    return (uint32_t)COMP_PRESSURE_MIN * 25 / 4;
+
+  // 2 * 3125 * (...) / divisor of the API in 1/16 Pa
+  pressure = ((uint32_t)1048576 - adc_p - (uint32_t)(var2 / 4096)) * 3125;
+  pressure16 = (int32_t)comp_div(pressure, divisor, 1 + 8 + 4);
+  pressure = (uint32_t)pressure16 / 16;
+
+  var1 = (comp->p9 * (int32_t)(((pressure / 8) * (pressure / 8)) / 8192)) / 4096;
+  var2 = ((int32_t)(pressure / 4) * comp->p8) / 8192;
+  pressure16 += var1 + var2 + comp->p7;
+
+  if (pressure16 < COMP_PRESSURE_MIN)
+    pressure16 = COMP_PRESSURE_MIN;
+  else if (pressure16 > COMP_PRESSURE_MAX)
+    pressure16 = COMP_PRESSURE_MAX;
+
+  return (uint32_t)pressure16 * 25 / 4;
+
+}
+
+/**
+ * BME280_CompHumidity: This function compensates raw humidity (same result as the API)
+ * Arguments:
+ *    [0] BME280_Comp * comp: pointer to the constants struct, after BME280_CompTemperature(...)
+ *    [1] uint32_t adc_h: raw humidity (bme280_uncomp_data)
+ * Returns:
+ *    humidity [1/1024 %RH]
+ *
+*/
+uint32_t BME280_CompHumidity(const struct BME280_Comp * comp, uint32_t adc_h){
+  int32_t var1;
+  int32_t var2;
+  int32_t var3;
+  int32_t var4;
+  int32_t var5;
+  uint32_t humidity;
+
+  var1 = comp->t_fine - 76800;
+  var5 = (((int32_t)(adc_h * 16384) - comp->h4 - comp->h5 * var1) + 16384) / 32768;
+  var2 = (var1 * comp->h6) / 1024;
+  var3 = (var1 * comp->h3) / 2048;
+  var4 = ((var2 * (var3 + 32768)) / 1024) + 2097152;
+  var2 = ((var4 * comp->h2) + 8192) / 16384;
+  var3 = var5 * var2;
+  var4 = ((var3 / 32768) * (var3 / 32768)) / 128;
+  var5 = var3 - ((var4 * comp->h1) / 16);
+  var5 = (var5 < 0) ? 0 : var5;
+  var5 = (var5 > 419430400) ? 419430400 : var5;
+
+  humidity = (uint32_t)(var5 / 4096);
+  if (humidity > COMP_HUMIDITY_MAX)
+    humidity = COMP_HUMIDITY_MAX;
+
+  return humidity;
+
+}
+
+/**
+ * BME280_Compensate: This function compensates selected channels of one reading
+ * Arguments:
+ *    [0] BME280_Comp * comp: pointer to the constants struct
+ *    [1] uint8_t channels: BME280_PRESS, BME280_TEMP and/or BME280_HUM
+ *    [2] bme280_uncomp_data * raw: pointer to raw data (bme280_parse_sensor_data(...))
+ *    [3] BME280_Result * result: pointer to store the readings to; other channels are 0
+ * Note:
+ *    temperature is compensated always, the other channels need it
+ *
+*/
+void BME280_Compensate(struct BME280_Comp * comp, uint8_t channels, const struct bme280_uncomp_data * raw, struct BME280_Result * result){
+
+  result->temperature = BME280_CompTemperature(comp, raw->temperature);
+  result->pressure = (channels & BME280_PRESS) ? BME280_CompPressure(comp, raw->pressure) : 0;
+  result->humidity = (channels & BME280_HUM) ? BME280_CompHumidity(comp, raw->humidity) : 0;
+
+}
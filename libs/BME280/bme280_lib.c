@@ -2,11 +2,26 @@
 #include "bme280_lib.h"
 #include <stdio.h>
 
-int8_t i2c_write(uint8_t i2c_addr, uint8_t reg_addr, uint8_t * data, uint16_t len);
-int8_t i2c_read(uint8_t i2c_addr, uint8_t reg_addr, uint8_t * data, uint16_t len);
+int8_t i2c_write(uint8_t i2c_addr, uint8_t reg_addr, uint8_t * data, uint16_t len, void * intf_ptr);
+int8_t i2c_read(uint8_t i2c_addr, uint8_t reg_addr, uint8_t * data, uint16_t len, void * intf_ptr);
 void print_rslt(const char api_name[], int8_t rslt);
+void bme280_async_end(struct bme280_dev * sensor, int8_t result);
+int8_t bme280_register(struct bme280_dev * sensor);
+struct bme280_bus * bme280_bus(const I2C_HandleTypeDef * i2c);
+struct BME280_Context * bme280_ctx(const struct bme280_dev * sensor);
+int8_t bme280_read_raw(struct bme280_dev * sensor, struct bme280_uncomp_data * raw);
+int8_t bme280_bus_recover(I2C_HandleTypeDef * i2c);
+
+// bus of started sensors with the one whose asynchronous reading is in progress on it
+struct bme280_bus {
+  I2C_HandleTypeDef * i2c;
+  struct bme280_dev * volatile pending;
+};
+
+// started sensors (up to BME280_MAX_SENSORS) and their buses; I2C callbacks are dispatched by bus
+static struct bme280_dev * bme280_sensors[BME280_MAX_SENSORS];
+static struct bme280_bus bme280_buses[BME280_MAX_SENSORS];
 
-I2C_HandleTypeDef * i2c_conf;
 /**
  * BME280_Start: This function establishes connection to the BME sensor and
  *                  initializes it with given parameters;
@@ -15,25 +30,43 @@ I2C_HandleTypeDef * i2c_conf;
  *    [1] bme280_settings * cfg: pointer to the sensor configuration struct
  *    [2] I2C_HandleTypeDef * i2c: pointer to i2c configuration 
  * Note:
- *    BME280DeviceDef(...) macro creates main and settings structs with the given name
+ *    BME280DeviceDef(...) macro creates main, settings and context structs with the given name
  *    BME280(name) macro returns main and settings structs with given name (thus can be used to enter values)
+ *    Each sensor keeps its own bus, so sensors on different buses are read concurrently
+ *      (up to BME280_MAX_SENSORS); sensors on one bus need different addresses
  * 
 */
 int8_t BME280_Start(struct bme280_dev * sensor, struct bme280_settings * cfg, I2C_HandleTypeDef * i2c){
   // variables 
-  uint8_t result;
+  int8_t result;
+  struct BME280_Context * ctx;
 
-  // setting i2c for I/O
-  i2c_conf = i2c;
+  if ((cfg != NULL) && (sensor != NULL) && (sensor->intf_ptr != NULL) && (i2c != NULL)){
+    // setting i2c for I/O
+    ctx = sensor->intf_ptr;
+    ctx->i2c = i2c;
+    ctx->result = BME280_OK;
 
-  if ((cfg != NULL) && (sensor != NULL)){
     // mapping API functions
     sensor->delay_ms = HAL_Delay;
     sensor->read = i2c_read;
     sensor->write = i2c_write;
 
-    // reset and read chip-id and calib-data from sensor 
-    result = bme280_init(sensor);
+    result = bme280_register(sensor);
+
+    if (result == BME280_OK){
+      // reset and read chip-id and calib-data from sensor 
+      result = bme280_init(sensor);
+    }
+    else {
+      // not started
+      ctx->i2c = NULL;
+    }
+
+    if (result == BME280_OK){
+      // compensation constants are derived once here
+      BME280_CompInit(&ctx->comp, &sensor->calib_data);
+    }
 
     if (result == BME280_OK){
       // get current settings from the sensor
@@ -78,12 +111,18 @@ int8_t BME280_Start(struct bme280_dev * sensor, struct bme280_settings * cfg, I2
 
 int8_t BME280_GetPressure(double * pressure, struct bme280_dev * sensor){
   int8_t result;
-  struct bme280_data temporary;
+  struct bme280_uncomp_data raw;
+  struct BME280_Context * ctx = bme280_ctx(sensor);
+
+  if (ctx != NULL){
+    // bus and t_fine are in use by the asynchronous reading
+    if (BME280_AsyncStatus(sensor) == BME280_W_BUSY)
+      return BME280_W_BUSY;
 
-  if (sensor != NULL){
-    result = bme280_get_sensor_data(BME280_PRESS, &temporary, sensor);
+    result = bme280_read_raw(sensor, &raw);
     if (result == BME280_OK){
-      *pressure = (double)temporary.pressure / 100;
+      BME280_CompTemperature(&ctx->comp, raw.temperature);
+      *pressure = (double)BME280_CompPressure(&ctx->comp, raw.pressure) / 100;
     }
   
   }
@@ -95,35 +134,408 @@ int8_t BME280_GetPressure(double * pressure, struct bme280_dev * sensor){
 
 }
 
+/**
+ * BME280_GetAll: This function reads pressure, temperature and humidity in one burst and
+ *                  compensates every enabled channel (they share the temperature correction)
+ * Arguments:
+ *    [0] BME280_Result * result: pointer to store the readings to
+ *    [1] bme280_dev * sensor: pointer to the sensor main struct
+ * Note:
+ *    channel is enabled if its oversampling in bme280_settings is not BME280_NO_OVERSAMPLING;
+ *      temperature is always compensated, the others need it
+ *
+*/
+int8_t BME280_GetAll(struct BME280_Result * result, struct bme280_dev * sensor){
+  int8_t status;
+  uint8_t channels = BME280_TEMP;
+  struct bme280_uncomp_data raw;
+  struct BME280_Context * ctx = bme280_ctx(sensor);
+
+  if ((result == NULL) || (ctx == NULL))
+    return BME280_E_NULL_PTR;
+
+  if (BME280_AsyncStatus(sensor) == BME280_W_BUSY)
+    return BME280_W_BUSY;
+
+  if (sensor->settings.osr_p != BME280_NO_OVERSAMPLING)
+    channels |= BME280_PRESS;
+  if (sensor->settings.osr_h != BME280_NO_OVERSAMPLING)
+    channels |= BME280_HUM;
+
+  status = bme280_read_raw(sensor, &raw);
+  if (status == BME280_OK){
+    BME280_Compensate(&ctx->comp, channels, &raw, result);
+  }
+
+  return status;
+
+}
+
+/**
+ * BME280_GetPressureAsync: This function starts reading of the data registers with DMA and
+ *                  returns immediately; pressure is compensated when the transfer completes
+ * Arguments:
+ *    [0] double * pressure: pointer to store pressure to (valid after the reading ends with BME280_OK)
+ *    [1] bme280_dev * sensor: pointer to the sensor main struct
+ *    [2] BME280_AsyncCallback done: function called when the reading ends, may be NULL
+ * Returns:
+ *    BME280_OK - reading is started
+ *    BME280_W_BUSY - previous reading of the sensor (or other transfer on its bus) is still in progress
+ *    BME280_E_COMM_FAIL - transfer could not be started
+ * Note:
+ *    BME280_I2C_MemRxCpltCallback(...) and BME280_I2C_ErrorCallback(...) have to be called from
+ *      HAL_I2C_MemRxCpltCallback(...) and HAL_I2C_ErrorCallback(...)
+ *    DMA transfer cannot time out by itself; BME280_AsyncStatus(...) aborts it after BME280_ASYNC_TIMEOUT
+ *    With BME280_USE_FREERTOS the calling task is notified as well, e.g. wait with
+ *      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BME280_ASYNC_TIMEOUT))
+ *
+*/
+int8_t BME280_GetPressureAsync(double * pressure, struct bme280_dev * sensor, BME280_AsyncCallback done){
+  struct BME280_Context * ctx = bme280_ctx(sensor);
+  struct bme280_bus * bus;
+  HAL_StatusTypeDef status;
+  uint32_t primask;
+
+  if ((pressure == NULL) || (ctx == NULL))
+    return BME280_E_NULL_PTR;
+
+  if (BME280_AsyncStatus(sensor) == BME280_W_BUSY)
+    return BME280_W_BUSY;
+
+  bus = bme280_bus(ctx->i2c);
+  if (bus == NULL)
+    return BME280_E_NULL_PTR;
+
+  // claim the bus; I2C callbacks of the bus are dispatched to its pending sensor only
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (bus->pending != NULL){
+    __set_PRIMASK(primask);
+    return BME280_W_BUSY;
+  }
+  bus->pending = sensor;
+  __set_PRIMASK(primask);
+
+  ctx->pressure = pressure;
+  ctx->done = done;
+  ctx->start = HAL_GetTick();
+#ifdef BME280_USE_FREERTOS
+  ctx->task = xTaskGetCurrentTaskHandle();
+#endif
+  ctx->result = BME280_W_BUSY;
+
+  status = HAL_I2C_Mem_Read_DMA(ctx->i2c, sensor->dev_id << 1, BME280_DATA_ADDR, I2C_MEMADD_SIZE_8BIT, \
+                                ctx->data, BME280_P_T_H_DATA_LEN);
+  if (status != HAL_OK){
+    // nothing is started, no callback comes; bus is busy with a blocking transfer
+    ctx->result = (status == HAL_BUSY) ? BME280_OK : BME280_E_COMM_FAIL;
+    bus->pending = NULL;
+    return (status == HAL_BUSY) ? BME280_W_BUSY : BME280_E_COMM_FAIL;
+  }
+
+  return BME280_OK;
+
+}
+
+/**
+ * BME280_AsyncStatus: This function returns result of the last asynchronous reading and aborts
+ *                  it if it takes longer than BME280_ASYNC_TIMEOUT (e.g. bus is locked up)
+ * Arguments:
+ *    [0] bme280_dev * sensor: pointer to the sensor main struct
+ * Returns:
+ *    BME280_OK - reading is completed (or none was started)
+ *    BME280_W_BUSY - reading is in progress
+ *    BME280_E_TIMEOUT - reading timed out, bus is recovered (see bme280_bus_recover)
+ *    BME280_E_COMM_FAIL - reading failed, or bus could not be recovered after the timeout
+ *
+*/
+int8_t BME280_AsyncStatus(struct bme280_dev * sensor){
+  struct BME280_Context * ctx = bme280_ctx(sensor);
+  uint8_t timed_out = 0;
+  uint32_t primask;
+
+  if (ctx == NULL)
+    return BME280_E_NULL_PTR;
+
+  // completion interrupt must not end the reading between the check and the timeout;
+  //  once the result is not BME280_W_BUSY the callbacks ignore it (bus stays claimed)
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if ((ctx->result == BME280_W_BUSY) && (HAL_GetTick() - ctx->start > BME280_ASYNC_TIMEOUT)){
+    ctx->result = BME280_E_TIMEOUT;
+    timed_out = 1;
+  }
+  __set_PRIMASK(primask);
+
+  if (timed_out){
+    // HAL_I2C_Master_Abort_IT(...) ignores memory reads; stop DMA and reset the bus instead
+    if (bme280_bus_recover(ctx->i2c) == BME280_OK)
+      bme280_async_end(sensor, BME280_E_TIMEOUT);
+    else
+      bme280_async_end(sensor, BME280_E_COMM_FAIL);
+  }
+
+  return ctx->result;
+
+}
+
+/**
+ * BME280_I2C_MemRxCpltCallback: This function compensates data of the asynchronous reading
+ * Arguments:
+ *    [0] I2C_HandleTypeDef * i2c: hi2c argument of HAL_I2C_MemRxCpltCallback(...), other buses are ignored
+ *
+*/
+void BME280_I2C_MemRxCpltCallback(I2C_HandleTypeDef * i2c){
+  struct bme280_uncomp_data raw;
+  struct bme280_bus * bus = bme280_bus(i2c);
+  struct bme280_dev * sensor = (bus != NULL) ? bus->pending : NULL;
+  struct BME280_Context * ctx;
+
+  // one reading at a time is in progress on a bus, the one of its pending sensor
+  if (sensor == NULL)
+    return;
+
+  ctx = sensor->intf_ptr;
+  if (ctx->result == BME280_W_BUSY){
+    bme280_parse_sensor_data(ctx->data, &raw);
+    BME280_CompTemperature(&ctx->comp, raw.temperature);
+    *ctx->pressure = (double)BME280_CompPressure(&ctx->comp, raw.pressure) / 100;
+
+    bme280_async_end(sensor, BME280_OK);
+  }
+
+}
+
+/**
+ * BME280_I2C_ErrorCallback: This function ends the asynchronous reading after bus error
+ * Arguments:
+ *    [0] I2C_HandleTypeDef * i2c: hi2c argument of HAL_I2C_ErrorCallback(...), other buses are ignored
+ *
+*/
+void BME280_I2C_ErrorCallback(I2C_HandleTypeDef * i2c){
+  struct bme280_bus * bus = bme280_bus(i2c);
+  struct bme280_dev * sensor = (bus != NULL) ? bus->pending : NULL;
+  struct BME280_Context * ctx;
+
+  if (sensor == NULL)
+    return;
+
+  ctx = sensor->intf_ptr;
+  if (ctx->result == BME280_W_BUSY)
+    bme280_async_end(sensor, BME280_E_COMM_FAIL);
+
+}
+
+
+void bme280_async_end(struct bme280_dev * sensor, int8_t result){
+  struct BME280_Context * ctx = sensor->intf_ptr;
+  struct bme280_bus * bus = bme280_bus(ctx->i2c);
 
-int8_t i2c_write(uint8_t i2c_addr, uint8_t reg_addr, uint8_t * data, uint16_t len) {
+  ctx->result = result;
+
+  // bus is released before the callback, which may start the next reading
+  if ((bus != NULL) && (bus->pending == sensor))
+    bus->pending = NULL;
+
+  if (ctx->done != NULL)
+    ctx->done(sensor, result);
+
+#ifdef BME280_USE_FREERTOS
+  if (ctx->task != NULL){
+    BaseType_t woken = pdFALSE;
+
+    // timeout is detected in a task, there is nothing to yield to
+    if (xPortIsInsideInterrupt()){
+      vTaskNotifyGiveFromISR(ctx->task, &woken);
+      portYIELD_FROM_ISR(woken);
+    }
+    else
+      xTaskNotifyGive(ctx->task);
+  }
+#endif
+
+}
+
+int8_t bme280_register(struct bme280_dev * sensor){
+  struct BME280_Context * ctx = sensor->intf_ptr;
+  uint8_t free_slot = BME280_MAX_SENSORS;
+  uint8_t free_bus = BME280_MAX_SENSORS;
+  uint8_t registered = 0;
+
+  for (uint8_t i = 0; i < BME280_MAX_SENSORS; i++){
+    // restarted sensor keeps its slot
+    if (bme280_sensors[i] == sensor)
+      registered = 1;
+
+    if ((bme280_sensors[i] == NULL) && (free_slot == BME280_MAX_SENSORS))
+      free_slot = i;
+
+    if ((bme280_buses[i].i2c == NULL) && (free_bus == BME280_MAX_SENSORS))
+      free_bus = i;
+  }
+
+  if (!registered && (free_slot == BME280_MAX_SENSORS))
+    return BME280_E_TOO_MANY;
+
+  // bus of the sensor is known already, or takes a free slot
+  if ((bme280_bus(ctx->i2c) == NULL) && (free_bus == BME280_MAX_SENSORS))
+    return BME280_E_TOO_MANY;
+
+  if (!registered)
+    bme280_sensors[free_slot] = sensor;
+
+  if (bme280_bus(ctx->i2c) == NULL)
+    bme280_buses[free_bus].i2c = ctx->i2c;
+
+  return BME280_OK;
+
+}
+
+struct bme280_bus * bme280_bus(const I2C_HandleTypeDef * i2c){
+
+  for (uint8_t i = 0; i < BME280_MAX_SENSORS; i++){
+    if ((i2c != NULL) && (bme280_buses[i].i2c == i2c))
+      return &bme280_buses[i];
+  }
+
+  return NULL;
+
+}
+
+struct BME280_Context * bme280_ctx(const struct bme280_dev * sensor){
+  struct BME280_Context * ctx;
+
+  if ((sensor == NULL) || (sensor->intf_ptr == NULL))
+    return NULL;
+
+  // not started yet
+  ctx = sensor->intf_ptr;
+  return (ctx->i2c != NULL) ? ctx : NULL;
+
+}
+
+int8_t bme280_read_raw(struct bme280_dev * sensor, struct bme280_uncomp_data * raw){
+  uint8_t data[BME280_P_T_H_DATA_LEN] = { 0 };
+  int8_t result;
+
+  result = bme280_get_regs(BME280_DATA_ADDR, data, BME280_P_T_H_DATA_LEN, sensor);
+  if (result == BME280_OK){
+    bme280_parse_sensor_data(data, raw);
+  }
+
+  return result;
+
+}
+
+/**
+ * bme280_bus_recover: This function brings the I2C bus back after a timed out transfer;
+ *                  stops its DMA, releases a slave holding SDA low and reinitializes the peripheral
+ * Arguments:
+ *    [0] I2C_HandleTypeDef * i2c: bus of the sensor
+ * Returns:
+ *    BME280_OK - bus is ready again
+ *    BME280_E_COMM_FAIL - DMA abort or reinitialization failed, or SDA is still held low
+ * Note:
+ *    pins are those of STM32F103: I2C1 PB6/PB7 (PB8/PB9 remapped), I2C2 PB10/PB11;
+ *      HAL_I2C_DeInit(...) and HAL_I2C_Init(...) call the MSP functions, which switch them
+ *      between GPIO and I2C
+ *
+*/
+int8_t bme280_bus_recover(I2C_HandleTypeDef * i2c){
+  GPIO_InitTypeDef gpio = { 0 };
+  uint16_t scl, sda;
+  int8_t result = BME280_OK;
+
+  if ((i2c->hdmarx != NULL) && (HAL_DMA_Abort(i2c->hdmarx) != HAL_OK))
+    result = BME280_E_COMM_FAIL;
+
+  // handle goes back to HAL_I2C_STATE_RESET, peripheral and its pins are released
+  if (HAL_I2C_DeInit(i2c) != HAL_OK)
+    result = BME280_E_COMM_FAIL;
+
+  if (i2c->Instance == I2C2){
+    scl = GPIO_PIN_10;
+    sda = GPIO_PIN_11;
+  }
+  else if (AFIO->MAPR & AFIO_MAPR_I2C1_REMAP){
+    scl = GPIO_PIN_8;
+    sda = GPIO_PIN_9;
+  }
+  else {
+    scl = GPIO_PIN_6;
+    sda = GPIO_PIN_7;
+  }
+
+  HAL_GPIO_WritePin(GPIOB, scl | sda, GPIO_PIN_SET);
+  gpio.Pin = scl | sda;
+  gpio.Mode = GPIO_MODE_OUTPUT_OD;
+  gpio.Speed = GPIO_SPEED_FREQ_LOW;
+  HAL_GPIO_Init(GPIOB, &gpio);
+
+  // slave in the middle of a byte releases SDA within 9 clocks
+  for (uint8_t i = 0; (i < 9) && (HAL_GPIO_ReadPin(GPIOB, sda) == GPIO_PIN_RESET); i++){
+    HAL_GPIO_WritePin(GPIOB, scl, GPIO_PIN_RESET);
+    HAL_Delay(1);
+    HAL_GPIO_WritePin(GPIOB, scl, GPIO_PIN_SET);
+    HAL_Delay(1);
+  }
+
+  // STOP condition (SDA rises while SCL is high) ends the transfer for every slave
+  HAL_GPIO_WritePin(GPIOB, scl, GPIO_PIN_RESET);
+  HAL_GPIO_WritePin(GPIOB, sda, GPIO_PIN_RESET);
+  HAL_Delay(1);
+  HAL_GPIO_WritePin(GPIOB, scl, GPIO_PIN_SET);
+  HAL_Delay(1);
+  HAL_GPIO_WritePin(GPIOB, sda, GPIO_PIN_SET);
+  HAL_Delay(1);
+
+  if (HAL_GPIO_ReadPin(GPIOB, sda) == GPIO_PIN_RESET)
+    result = BME280_E_COMM_FAIL;
+
+  if (HAL_I2C_Init(i2c) != HAL_OK)
+    result = BME280_E_COMM_FAIL;
+
+  return result;
+
+}
+
+int8_t i2c_write(uint8_t i2c_addr, uint8_t reg_addr, uint8_t * data, uint16_t len, void * intf_ptr) {
+  struct BME280_Context * ctx = intf_ptr;
   
   i2c_addr <<= 1;
 
-  int8_t result = HAL_I2C_Mem_Write(i2c_conf, i2c_addr, (uint16_t)reg_addr,\
-                            I2C_MEMADD_SIZE_8BIT, data, len, HAL_MAX_DELAY );
+  int8_t result = HAL_I2C_Mem_Write(ctx->i2c, i2c_addr, (uint16_t)reg_addr,\
+                            I2C_MEMADD_SIZE_8BIT, data, len, BME280_I2C_TIMEOUT );
 
   if (result == HAL_OK)
     result = BME280_OK;
-  else 
+  else {
+    // slave may hold the bus; next transfer gets a working one
+    if (result == HAL_TIMEOUT)
+      bme280_bus_recover(ctx->i2c);
     result = BME280_E_COMM_FAIL;
+  }
 
   return result;
 
 }
 
-int8_t i2c_read(uint8_t i2c_addr, uint8_t reg_addr, uint8_t * data, uint16_t len){
+int8_t i2c_read(uint8_t i2c_addr, uint8_t reg_addr, uint8_t * data, uint16_t len, void * intf_ptr){
+  struct BME280_Context * ctx = intf_ptr;
 
   i2c_addr <<= 1;
 
-  int8_t result = HAL_I2C_Mem_Read(i2c_conf, i2c_addr, (uint16_t)reg_addr, \
-                                   I2C_MEMADD_SIZE_8BIT, data, len, HAL_MAX_DELAY);
+  int8_t result = HAL_I2C_Mem_Read(ctx->i2c, i2c_addr, (uint16_t)reg_addr, \
+                                   I2C_MEMADD_SIZE_8BIT, data, len, BME280_I2C_TIMEOUT);
 
   if (result == HAL_OK){
     result = BME280_OK;
   }
-  else 
+  else {
+    if (result == HAL_TIMEOUT)
+      bme280_bus_recover(ctx->i2c);
     result = BME280_E_COMM_FAIL;
+  }
 
   return result;
 
@@ -146,6 +558,10 @@ void print_rslt(const char api_name[], int8_t rslt)
     {
       printf("Error [%d] : Device not found\r\n", rslt);
     }
+    else if (rslt == BME280_E_TOO_MANY)
+    {
+      printf("Error [%d] : Too many sensors (BME280_MAX_SENSORS)\r\n", rslt);
+    }
     else
     {
       /* For more error codes refer "*_defs.h" */
@@ -7,6 +7,75 @@
 #include "bme280.h"
 #include "main.h"
 
+// Define BME280_USE_FREERTOS to notify the task which requested asynchronous reading when it completes
+#ifdef BME280_USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+
+/**
+ * ************************************************************
+ *                  Settings                                  *
+ * ************************************************************
+*/
+#define BME280_I2C_TIMEOUT 10 // Timeout of blocking I2C transfers [ms]
+#define BME280_ASYNC_TIMEOUT 10 // Timeout of DMA data reading, see BME280_AsyncStatus(...) [ms]
+#define BME280_MAX_SENSORS 2 // Maximum number of sensors started with BME280_Start(...) (on any buses)
+#define BME280_SEA_LEVEL 10132500 // Pressure at mean sea level of the standard atmosphere, see BME280_SetGround(...) [0.01 Pa]
+
+// Status codes besides the API ones (bme280_defs.h)
+#define BME280_W_BUSY INT8_C(2) // asynchronous reading is in progress
+#define BME280_E_TIMEOUT INT8_C(-7) // asynchronous reading did not complete in time
+#define BME280_E_TOO_MANY INT8_C(-8) // more than BME280_MAX_SENSORS sensors are started
+
+
+/**
+ * ************************************************************
+ *                  Types                                     *
+ * ************************************************************
+*/
+// Compensated readings of BME280_GetAll(...); channels with oversampling skipped are 0
+struct BME280_Result {
+  uint32_t pressure; // [0.01 Pa]
+  int32_t temperature; // [0.01 degC]
+  uint32_t humidity; // [1/1024 %RH]
+};
+
+// Compensation constants derived from bme280_calib_data by BME280_CompInit(...)
+struct BME280_Comp {
+  int32_t t1, t1x2, t2, t3;
+  int32_t p1, p2, p3, p4, p5x2, p6, p7, p8, p9;
+  int32_t h1, h2, h3, h4, h5, h6;
+  int32_t t_fine; // temperature of the last reading, used by pressure and humidity
+};
+
+// Reference of BME280_Altitude(...), set by BME280_SetGround(...)
+struct BME280_Ground {
+  uint32_t pressure; // [0.01 Pa]
+  int32_t ratio; // (pressure / BME280_SEA_LEVEL) ^ 0.190263, Q30
+  int32_t scale; // 44330.77 m / ratio, altitude of unit ratio difference [mm] (integer, not Q30)
+};
+
+// Called from interrupt (or BME280_AsyncStatus) when asynchronous reading ends with given result
+typedef void (*BME280_AsyncCallback)(struct bme280_dev * sensor, int8_t result);
+
+// Transport and compensation context of one sensor, intf_ptr of bme280_dev (see BME280DeviceDef)
+struct BME280_Context {
+  I2C_HandleTypeDef * i2c; // bus of the sensor, set by BME280_Start(...)
+  struct BME280_Comp comp;
+
+  // asynchronous (DMA) reading, see BME280_GetPressureAsync(...)
+  double * pressure;
+  BME280_AsyncCallback done;
+  volatile int8_t result;
+  uint32_t start;
+  uint8_t data[BME280_P_T_H_DATA_LEN];
+#ifdef BME280_USE_FREERTOS
+  TaskHandle_t task;
+#endif
+};
+
 
 /**
  * ************************************************************
@@ -18,9 +87,11 @@
                         pres_oversampling, \
                         humid_oversampling, \
                         filter_coef, resttime) \
+struct BME280_Context bme280_ctx_ ## name; \
 struct bme280_dev bme280_ ## name = {\
   .dev_id = address, \
   .intf = BME280_I2C_INTF, \
+  .intf_ptr = &bme280_ctx_ ## name, \
 }; \
 struct bme280_settings bme280_conf_ ## name = {\
   .osr_t = temp_oversampling, \
@@ -41,5 +112,22 @@ struct bme280_settings bme280_conf_ ## name = {\
 */
 int8_t BME280_Start(struct bme280_dev * sensor, struct bme280_settings * cfg ,I2C_HandleTypeDef * i2c);
 int8_t BME280_GetPressure(double * pressure, struct bme280_dev * sensor);
+int8_t BME280_GetAll(struct BME280_Result * result, struct bme280_dev * sensor);
+int8_t BME280_GetPressureAsync(double * pressure, struct bme280_dev * sensor, BME280_AsyncCallback done);
+int8_t BME280_AsyncStatus(struct bme280_dev * sensor);
+
+void BME280_I2C_MemRxCpltCallback(I2C_HandleTypeDef * i2c);
+void BME280_I2C_ErrorCallback(I2C_HandleTypeDef * i2c);
+
+// bme280_comp.c
+void BME280_CompInit(struct BME280_Comp * comp, const struct bme280_calib_data * calib);
+int32_t BME280_CompTemperature(struct BME280_Comp * comp, uint32_t adc_t);
+uint32_t BME280_CompPressure(const struct BME280_Comp * comp, uint32_t adc_p);
+uint32_t BME280_CompHumidity(const struct BME280_Comp * comp, uint32_t adc_h);
+void BME280_Compensate(struct BME280_Comp * comp, uint8_t channels, const struct bme280_uncomp_data * raw, struct BME280_Result * result);
+
+// bme280_alt.c
+void BME280_SetGround(struct BME280_Ground * ground, uint32_t pressure);
+int32_t BME280_Altitude(const struct BME280_Ground * ground, uint32_t pressure);
 
 #endif
\ No newline at end of file
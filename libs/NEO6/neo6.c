@@ -5,359 +5,2002 @@
 
 #include "neo6.h"
 
-char UART_ReceivedChar;
+/**
+ * Initialized NEO6 structs, used to find the struct of UART in HAL callbacks
+ *  (written only by NEO6_Init(...) / NEO6_InitDMA(...))
+*/
+static struct NEO6 *neo6_instances[GPS_MAX_INSTANCES];
 
 
 /**  --------------------------- INTERNAL FUNCTIONS ---------------------------  **/
 
 /**
- * INTERNAL FUNCTION
+ * INTERNAL FUNCTION
+ * 
+ * @brief Convert leading decimal digits of the field to integer (like atoi, without sign)
+ * 
+ * @param field: pointer to cstring which contains the field
+ * 
+ * @retval (uint32_t) value of the digits
+*/
+uint32_t nmea_uint(const char *field)
+{
+	uint32_t value = 0;
+
+	while (*field >= '0' && *field <= '9')
+		value = value * 10 + (uint32_t)(*field++ - '0');
+
+	return value;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Convert decimal field (e.g. -12.345) to fixed-point integer with given number of decimals
+ * 	  extra decimals are truncated, missing ones are padded with zeros
+ * 
+ * @param field: pointer to cstring which contains the field
+ * @param decimals: number of decimals in result (12.345 with 2 decimals = 1234)
+ * 
+ * @retval (int32_t) fixed-point value
+*/
+int32_t nmea_fixed(const char *field, uint8_t decimals)
+{
+	uint8_t negative = (*field == '-');
+	int32_t value;
+
+	if (negative)
+		field++;
+
+	// integer part; digits are read only once
+	value = 0;
+	while (*field >= '0' && *field <= '9')
+		value = value * 10 + (*field++ - '0');
+
+	if (*field == '.')
+		field++;
+
+	for (; decimals; decimals--) {
+		value *= 10;
+		if (*field >= '0' && *field <= '9')
+			value += *field++ - '0';
+	}
+
+	return negative ? -value : value;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Convert NMEA coordinate field (dddmm.mmmmm) to 1e-7 degrees
+ * 
+ * @param field: pointer to cstring which contains the coordinate field
+ * 
+ * @retval (int32_t) coordinate value in 1e-7 degrees
+*/
+int32_t nmea_coord(const char *field)
+{
+	// minutes in 1e-5 units, dddmm.mmmmm -> dddmmmmmmm
+	int32_t value = nmea_fixed(field, 5);
+	int32_t deg = value / 10000000;
+	int32_t min = value % 10000000;
+
+	// 1e-5 minutes to 1e-7 degrees: * 100 / 60 (rounded)
+	return deg * GPS_COORD_SCALE + (min * 10 + 3) / 6;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Convert NMEA time field (hhmmss.sss) to milliseconds since midnight
+ * 
+ * @param field: pointer to cstring which contains the time field
+ * 
+ * @retval (uint32_t) time of day in ms
+*/
+uint32_t nmea_time(const char *field)
+{
+	uint32_t value = (uint32_t)nmea_fixed(field, 3);
+	uint32_t hhmmss = value / 1000;
+
+	return ((hhmmss / 10000) * 3600 + ((hhmmss / 100) % 100) * 60 + hhmmss % 100) * 1000 + value % 1000;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Clear parsed information to its default (invalid) values
+ * 
+ * @param info: Pointer to NEO6 gps info struct
+ * 
+ * @retval void
+*/
+void nmea_info_clear(struct NEO6_ParsedInfo *info)
+{
+	info->quality = 0;
+
+	info->pos.lat = 0;
+	info->pos.lat_dir = '0';
+
+	info->pos.lon = 0;
+	info->pos.lon_dir = '0';
+
+	info->pos.alt = 0;
+
+	info->satellites = 0;
+	info->hdop = 0;
+	info->pdop = 0;
+	info->vdop = 0;
+
+	info->speed = 0;
+	info->course = 0;
+
+	info->utc_time = 0;
+	info->utc_ms = 0;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Check if PRN (1 .. 96) is set in bit mask of used satellites
+ * 
+ * @retval (uint8_t) 1 if set
+*/
+uint8_t neo6_prn_used(const uint32_t *used, uint8_t prn)
+{
+	if (prn < 1 || prn > 96)
+		return 0;
+
+	return (used[(prn - 1) / 32] >> ((prn - 1) % 32)) & 1;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Store satellites used in fix (GSA) and mark them in the table
+ * 
+ * @retval void
+*/
+void neo6_sats_used(struct NEO6_SatTable *table, const uint32_t *used)
+{
+	for (uint8_t i = 0; i < 3; i++)
+		table->used[i] = used[i];
+
+	for (uint8_t i = 0; i < table->count; i++)
+		table->sat[i].used = neo6_prn_used(used, table->sat[i].prn);
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Store satellites of completed GSV part at their place in the table
+ * 
+ * Each part costs at most GPS_GSV_SATS entries; entries of a lost part 
+ *  stay from the previous sequence
+ * 
+ * @retval void
+*/
+void neo6_sats_store(struct NEO6_SatTable *table, const struct NMEA_Parser *parser)
+{
+	uint16_t base = (parser->gsv_part - 1) * GPS_GSV_SATS;
+
+	if (!parser->gsv_part || parser->gsv_part > parser->gsv_parts)
+		return ;
+
+	for (uint8_t i = 0; i < parser->gsv_count && base + i < GPS_MAX_SATS; i++) {
+		table->sat[base + i] = parser->gsv[i];
+		table->sat[base + i].used = neo6_prn_used(table->used, parser->gsv[i].prn);
+	}
+
+	table->in_view = parser->gsv_in_view;
+	table->count = (parser->gsv_in_view < GPS_MAX_SATS) ? parser->gsv_in_view : GPS_MAX_SATS;
+}
+
+
+/**
+ * INTERNAL FUNCTION 
+ * 
+ * @brief Copy information of the just completed sentence to the user struct
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * 		(used to store info and handle Neo6 GPS device)
+ * 
+ * @retval Status Code
+ * 
+*/
+uint8_t calc_info(struct NEO6 *gps)
+{       
+	struct NMEA_Parser *parser = &gps->parser;
+	struct NEO6_ParsedInfo *info = &parser->info;
+
+	switch (gps->parser.sentence) {
+	case NMEA_SENTENCE_GGA:
+	case NMEA_SENTENCE_RMC:
+		break;
+
+	case NMEA_SENTENCE_VTG:
+		// no quality of its own; valid while the fix is
+		if (gps->info.quality) {
+			gps->info.speed = info->speed;
+			gps->info.course = info->course;
+		}
+		return GPS_OK;
+
+	case NMEA_SENTENCE_GSA:
+		if (info->pdop) {
+			gps->info.pdop = info->pdop;
+			gps->info.hdop = info->hdop;
+			gps->info.vdop = info->vdop;
+		}
+
+		if (parser->sentence_groups & GPS_FIELD_SATS)
+			neo6_sats_used(&gps->sats, parser->gsa_used);
+		return GPS_OK;
+
+	case NMEA_SENTENCE_GSV:
+		neo6_sats_store(&gps->sats, parser);
+		return GPS_OK;
+
+	default:
+		// unknown sentences are skipped without touching the stored info
+		return GPS_MESSAGE_INVALID;
+	}
+
+	gps->info.quality = info->quality;
+	if (info->quality){
+		gps->fix_tick = HAL_GetTick();
+
+		// fields of groups that are not subscribed were not converted, keep the stored ones
+		if (parser->sentence_groups & GPS_FIELD_POSITION) {
+			gps->info.pos.lat = info->pos.lat;
+			gps->info.pos.lat_dir = info->pos.lat_dir;
+
+			gps->info.pos.lon = info->pos.lon;
+			gps->info.pos.lon_dir = info->pos.lon_dir;
+		}
+
+		if (parser->time_of_day != UINT32_MAX) {
+			uint32_t seconds = parser->time_of_day / 1000;
+			uint32_t days = parser->date;
+
+			if (!days) {
+				// GGA has no date; use the last one, which may be a day behind
+				days = gps->info.utc_time / 86400;
+				if (days && seconds + 43200 < gps->info.utc_time % 86400)
+					days++;
+			}
+
+			gps->info.utc_time = days * 86400 + seconds;
+			gps->info.utc_ms = parser->time_of_day % 1000;
+		}
+		
+		if (info->pos.alt)
+			gps->info.pos.alt = info->pos.alt;
+
+		if (gps->parser.sentence == NMEA_SENTENCE_RMC && (parser->sentence_groups & GPS_FIELD_SPEED)) {
+			gps->info.speed = info->speed;
+			gps->info.course = info->course;
+		}
+
+		// only GGA has DOP and number of satellites; one position per epoch is averaged
+		if (gps->parser.sentence == NMEA_SENTENCE_GGA) {
+			if (parser->sentence_groups & GPS_FIELD_DOP) {
+				gps->info.satellites = info->satellites;
+				gps->info.hdop = info->hdop;
+			}
+			if (parser->sentence_groups & GPS_FIELD_POSITION)
+				NEO6_FilterUpdate(&gps->filter, &gps->info);
+		}
+
+		if (parser->sentence_groups & GPS_FIELD_POSITION)
+			NEO6_PredictUpdate(&gps->predict, &gps->info, gps->fix_tick);
+	}
+
+        return GPS_OK;
+}
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * Parse single field of GGA message (time, position and quality of fix)
+ * 
+*/
+void NMEA_GGAParse(struct NMEA_Parser *parser, uint8_t field_idx, char *field)
+{
+	struct NEO6_ParsedInfo *info = &parser->info;
+
+	switch (field_idx) {
+	case 1: // Time of fix
+		parser->time_of_day = nmea_time(field);
+		break;
+	case 2: // Latitude value
+		info->pos.lat = nmea_coord(field);
+		break;
+	case 3: // Latitude direction
+		info->pos.lat_dir = *field;
+		break;
+	case 4: // Longtitude value
+		info->pos.lon = nmea_coord(field);
+		break;
+	case 5: // Longtitude direction
+		info->pos.lon_dir = *field;
+		break;
+	case 6: // Quality of fix
+		info->quality = (uint8_t)nmea_uint(field);
+		break;
+	case 7: // Number of satellites
+		info->satellites = (uint8_t)nmea_uint(field);
+		break;
+	case 8: // HDOP
+		info->hdop = (uint16_t)nmea_fixed(field, 2);
+		break;
+	case 9: // Altitude
+		info->pos.alt = nmea_fixed(field, 3);
+		break;
+	default: // Geoid separation, ...
+		break;
+	}
+}
+
+/**
+ * INTERNAL FUNCTION 
+ * 
+ * Parse single field of RMC message (time, date, position, speed and course)
+*/
+void NMEA_RMCParse(struct NMEA_Parser *parser, uint8_t field_idx, char *field)
+{
+	struct NEO6_ParsedInfo *info = &parser->info;
+
+	switch (field_idx) {
+	case 1: // Time of FIX
+		parser->time_of_day = nmea_time(field);
+		break;
+	case 2: // Quality of Data
+		info->quality = (*field == 'V') ? 0 : 1;
+		break;
+	case 3: // Latitude value
+		info->pos.lat = nmea_coord(field);
+		break;
+	case 4: // Latitude direction
+		info->pos.lat_dir = *field;
+		break;
+	case 5: // Longtitude value
+		info->pos.lon = nmea_coord(field);
+		break;
+	case 6: // Longtitude direction
+		info->pos.lon_dir = *field;
+		break;
+	case 7: // Speed over ground (knots); 1 knot = 0.514444 m/s = 463/9000 cm/s per 0.001 knot
+		info->speed = (uint16_t)(nmea_fixed(field, 3) * 463 / 9000);
+		break;
+	case 8: // Course over ground (degrees)
+		info->course = (uint16_t)nmea_fixed(field, 2);
+		break;
+	case 9: { // UTC date of FIX (ddmmyy)
+		uint32_t date = nmea_uint(field);
+		struct NEO6_DateTime dt = { 
+			.year = 2000 + date % 100, 
+			.month = (date / 100) % 100, 
+			.day = (date / 10000) % 100 
+		};
+		parser->date = (uint16_t)(NEO6_MakeTime(&dt) / 86400);
+		break;
+	}
+	default: // Magnetic variation, ...
+		break;
+	}
+}
+
+/**
+ * INTERNAL FUNCTION 
+ * 
+ * Parse single field of VTG message (course and speed over ground)
+*/
+void NMEA_VTGParse(struct NMEA_Parser *parser, uint8_t field_idx, char *field)
+{
+	struct NEO6_ParsedInfo *info = &parser->info;
+
+	switch (field_idx) {
+	case 1: // Course over ground (true, degrees)
+		info->course = (uint16_t)nmea_fixed(field, 2);
+		break;
+	case 7: // Speed over ground (km/h); 0.001 km/h = 1/36 cm/s
+		info->speed = (uint16_t)(nmea_fixed(field, 3) / 36);
+		break;
+	default: // Magnetic course, speed in knots, units, mode
+		break;
+	}
+}
+
+/**
+ * INTERNAL FUNCTION 
+ * 
+ * Parse single field of GSA message (dilution of precision)
+*/
+void NMEA_GSAParse(struct NMEA_Parser *parser, uint8_t field_idx, char *field)
+{
+	struct NEO6_ParsedInfo *info = &parser->info;
+
+	switch (field_idx) {
+	case 15: // PDOP
+		info->pdop = (uint16_t)nmea_fixed(field, 2);
+		break;
+	case 16: // HDOP
+		info->hdop = (uint16_t)nmea_fixed(field, 2);
+		break;
+	case 17: // VDOP
+		info->vdop = (uint16_t)nmea_fixed(field, 2);
+		break;
+	default: // Mode, fix type, PRNs of used satellites (3 .. 14)
+		if (field_idx >= 3 && field_idx <= 14) {
+			uint32_t prn = nmea_uint(field);
+
+			if (prn >= 1 && prn <= 96)
+				parser->gsa_used[(prn - 1) / 32] |= 1UL << ((prn - 1) % 32);
+		}
+		break;
+	}
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * Parse single field of GSV message (satellites in view; 4 per sentence)
+ * 
+*/
+void NMEA_GSVParse(struct NMEA_Parser *parser, uint8_t field_idx, char *field)
+{
+	uint8_t sat, value;
+
+	switch (field_idx) {
+	case 1: // Number of parts
+		parser->gsv_parts = (uint8_t)nmea_uint(field);
+		break;
+	case 2: // Part number
+		parser->gsv_part = (uint8_t)nmea_uint(field);
+		break;
+	case 3: // Satellites in view
+		parser->gsv_in_view = (uint8_t)nmea_uint(field);
+		break;
+	default: // PRN, elevation, azimuth, SNR of up to 4 satellites
+		if (field_idx < 4 || field_idx >= 4 + 4 * GPS_GSV_SATS)
+			break;
+
+		sat = (field_idx - 4) / 4;
+		value = (field_idx - 4) % 4;
+
+		if (value == 0) {
+			// satellite starts with PRN; empty fields after it stay 0
+			struct NEO6_Satellite *entry = &parser->gsv[sat];
+
+			entry->prn = (uint8_t)nmea_uint(field);
+			entry->elevation = 0;
+			entry->azimuth = 0;
+			entry->snr = 0;
+			entry->used = 0;
+			parser->gsv_count = sat + 1;
+		}
+		else if (sat < parser->gsv_count) {
+			if (value == 1)
+				parser->gsv[sat].elevation = (uint8_t)nmea_uint(field);
+			else if (value == 2)
+				parser->gsv[sat].azimuth = (uint16_t)nmea_uint(field);
+			else 
+				parser->gsv[sat].snr = (uint8_t)nmea_uint(field);
+		}
+		break;
+	}
+}
+
+
+// Sentence type (last three chars of address) packed as in NMEA_Parser::address
+#define NMEA_TYPE(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
+
+/**
+ * Parsers of recognized sentences, indexed by NMEA_SENTENCE_*
+ * 
+*/
+// Field groups (GPS_FIELD_*) of fields used by the parse functions; index = field number
+#define F_POS GPS_FIELD_POSITION
+#define F_REQ GPS_FIELD_REQUIRED
+
+static const uint16_t gga_fields[] = { 
+	0, GPS_FIELD_TIME, F_POS, F_POS, F_POS, F_POS, F_REQ, GPS_FIELD_DOP, GPS_FIELD_DOP, GPS_FIELD_ALTITUDE 
+};
+static const uint16_t rmc_fields[] = { 
+	0, GPS_FIELD_TIME, F_REQ, F_POS, F_POS, F_POS, F_POS, GPS_FIELD_SPEED, GPS_FIELD_SPEED, GPS_FIELD_TIME 
+};
+static const uint16_t vtg_fields[] = { 
+	0, GPS_FIELD_SPEED, 0, 0, 0, 0, 0, GPS_FIELD_SPEED 
+};
+static const uint16_t gsa_fields[] = { 
+	0, 0, 0, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, 
+	GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, 
+	GPS_FIELD_SATS, GPS_FIELD_DOP, GPS_FIELD_DOP, GPS_FIELD_DOP 
+};
+static const uint16_t gsv_fields[4 + 4 * GPS_GSV_SATS] = { 
+	0, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, 
+	// PRN, elevation, azimuth and SNR of each satellite (one line per GPS_GSV_SATS)
+	GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, 
+	GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, 
+	GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, 
+	GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS, GPS_FIELD_SATS 
+};
+
+#undef F_POS
+#undef F_REQ
+
+#define NMEA_FIELDS(table) table, sizeof(table) / sizeof(table[0])
+
+static const struct {
+	uint32_t type;
+	void (*parse)(struct NMEA_Parser *parser, uint8_t field_idx, char *field);
+	const uint16_t *fields;
+	uint8_t field_count;
+} nmea_sentences[NMEA_SENTENCE_TYPES] = {
+	[NMEA_SENTENCE_UNKNOWN] = { 0, NULL, NULL, 0 },
+	[NMEA_SENTENCE_GGA] = { NMEA_TYPE('G', 'G', 'A'), NMEA_GGAParse, NMEA_FIELDS(gga_fields) },
+	[NMEA_SENTENCE_RMC] = { NMEA_TYPE('R', 'M', 'C'), NMEA_RMCParse, NMEA_FIELDS(rmc_fields) },
+	[NMEA_SENTENCE_VTG] = { NMEA_TYPE('V', 'T', 'G'), NMEA_VTGParse, NMEA_FIELDS(vtg_fields) },
+	[NMEA_SENTENCE_GSA] = { NMEA_TYPE('G', 'S', 'A'), NMEA_GSAParse, NMEA_FIELDS(gsa_fields) },
+	[NMEA_SENTENCE_GSV] = { NMEA_TYPE('G', 'S', 'V'), NMEA_GSVParse, NMEA_FIELDS(gsv_fields) },
+};
+
+#define NMEA_SENTENCE_COUNT (sizeof(nmea_sentences) / sizeof(nmea_sentences[0]))
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Find type of sentence from its address field (e.g. GPGGA, GNRMC)
+ * 
+ * @param parser: Pointer to NMEA parser state, after address field is received
+ * 
+ * @retval (uint8_t) NMEA_SENTENCE_*
+*/
+uint8_t nmea_sentence_type(struct NMEA_Parser *parser)
+{
+	uint8_t talker = (uint8_t)(parser->address >> 24);
+	uint32_t type = parser->address & 0x00FFFFFFU;
+
+	// GPS, GNSS (combined), GLONASS and Galileo talkers
+	if (parser->field_len != 5 || parser->field[0] != 'G' || 
+	    (talker != 'P' && talker != 'N' && talker != 'L' && talker != 'A'))
+		return NMEA_SENTENCE_UNKNOWN;
+
+	for (uint8_t i = 1; i < NMEA_SENTENCE_COUNT; i++) {
+		if (nmea_sentences[i].type == type)
+			return i;
+	}
+
+	return NMEA_SENTENCE_UNKNOWN;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Process the field which has just been completed by ',', '*' or '\r'
+ * 
+ * @param parser: Pointer to NMEA parser state
+ * 
+ * @retval void
+*/
+void nmea_field_end(struct NMEA_Parser *parser)
+{
+	parser->field[parser->field_len] = '\0';
+
+	if (parser->field_idx == 0) {
+		// Address field; "$$GPGGA" is handled by restarting on second '$'
+		uint8_t sentence = nmea_sentence_type(parser);
+		uint32_t primask = __get_PRIMASK();
+
+		// subscription may change meanwhile (NMEA_Subscribe); whole sentence uses the same one
+		__disable_irq();
+		parser->sentence_fields = parser->field_mask[sentence];
+		parser->sentence_groups = parser->subscribed;
+		__set_PRIMASK(primask);
+
+		// sentence without subscribed fields costs nothing (e.g. GSV without satellite table)
+		parser->sentence = parser->sentence_fields ? sentence : NMEA_SENTENCE_UNKNOWN;
+	}
+	else if (parser->sentence != NMEA_SENTENCE_UNKNOWN && parser->field_len && parser->field_idx < 32 && 
+		 (parser->sentence_fields >> parser->field_idx) & 1) {
+		// only fields of subscribed groups are converted
+		nmea_sentences[parser->sentence].parse(parser, parser->field_idx, parser->field);
+	}
+
+	parser->field_len = 0;
+	if (parser->field_idx < UINT8_MAX)
+		parser->field_idx++;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Check 4 chars at once for chars which end plain run of field chars 
+ * 	  (',', '*', '$', control chars including '\r', and chars above '~')
+ * 
+ * Uses the "has zero byte" trick: (x - 0x01..) & ~x & 0x80.. is non-zero
+ *  if any byte of x is zero; it may also flag bytes above a real match,
+ *  which does not matter here
+ * 
+ * @param word: 4 chars in any byte order
+ * 
+ * @retval (uint32_t) non-zero if any of the chars is special
+*/
+uint32_t nmea_special_chars(uint32_t word)
+{
+	uint32_t comma = word ^ 0x2C2C2C2CU;
+	uint32_t star = word ^ 0x2A2A2A2AU;
+	uint32_t dollar = word ^ 0x24242424U;
+
+	return (((comma - 0x01010101U) & ~comma) |
+		((star - 0x01010101U) & ~star) |
+		((dollar - 0x01010101U) & ~dollar) |
+		// below ' '
+		((word - 0x20202020U) & ~word) |
+		// above '~' (0x7F .. 0xFF)
+		((word + 0x01010101U) | word)) & 0x80808080U;
+}
+
+
+/** --------------------------- LIBRARY FUNCTIONS --------------------------- **/
+
+/**
+ * @brief Reset NMEA parser; following chars are ignored until '$' is received
+ * 
+ * @param parser: Pointer to NMEA parser state
+ * 
+ * @retval void
+*/
+void NMEA_ParserReset(struct NMEA_Parser *parser)
+{
+	nmea_info_clear(&parser->info);
+
+	parser->field_len = 0;
+	parser->field_idx = 0;
+	parser->sentence = NMEA_SENTENCE_UNKNOWN;
+	parser->sentence_fields = 0;
+	parser->sentence_groups = 0;
+	parser->address = 0;
+	parser->time_of_day = UINT32_MAX;
+	parser->date = 0;
+	parser->state = NMEA_STATE_IDLE;
+	parser->length = 0;
+
+	parser->checksum = 0;
+	parser->received_checksum = 0;
+	parser->checksum_digits = 0;
+
+	parser->gsv_count = 0;
+	parser->gsv_part = 0;
+	parser->gsv_parts = 0;
+	parser->gsv_in_view = 0;
+	parser->gsa_used[0] = 0;
+	parser->gsa_used[1] = 0;
+	parser->gsa_used[2] = 0;
+}
+
+
+/**
+ * @brief Select groups of fields converted by the parser; other fields are skipped 
+ * 	  without conversion, and sentences without selected fields are skipped whole
+ * 
+ * @param parser: Pointer to NMEA parser state
+ * @param fields: GPS_FIELD_* groups (quality of fix is always converted)
+ * 
+ * @retval void
+*/
+void NMEA_Subscribe(struct NMEA_Parser *parser, uint16_t fields)
+{
+	uint32_t field_mask[NMEA_SENTENCE_TYPES];
+	uint32_t primask;
+
+	fields |= GPS_FIELD_REQUIRED;
+
+	for (uint8_t i = 0; i < NMEA_SENTENCE_TYPES; i++) {
+		uint32_t mask = 0;
+
+		for (uint8_t field = 0; field < nmea_sentences[i].field_count && field < 32; field++) {
+			if (nmea_sentences[i].fields[field] & fields)
+				mask |= 1UL << field;
+		}
+
+		field_mask[i] = mask;
+	}
+
+	// parser (UART interrupt or parsing task) must not see half of the masks
+	primask = __get_PRIMASK();
+	__disable_irq();
+	parser->subscribed = fields;
+	memcpy(parser->field_mask, field_mask, sizeof(field_mask));
+	__set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Feed single received char to the streaming NMEA parser
+ * 
+ * Fields are converted as soon as their terminating ',' arrives, 
+ *  parsed sentence is available in parser->info when GPS_MSG_CPLT is returned
+ *  (i.e. only if checksum after '*' matches XOR of the sentence)
+ * 
+ * @param parser: Pointer to NMEA parser state
+ * @param c: received char
+ * 
+ * @retval Status Code
+ * 	GPS_MSG_CPLT - sentence with valid checksum is completed ('\r' received)
+ * 	GPS_MESSAGE_INVALID - sentence is dropped (wrong or missing checksum, invalid char)
+ * 	GPS_BUF_FULL - sentence or field is too long, sentence is dropped
+ * 	GPS_CHR_RECEIVED - otherwise
+*/
+uint8_t NMEA_ParseChar(struct NMEA_Parser *parser, char c)
+{
+	if (c == '$') {
+		// beginning of new sentence; unfinished one (if any) is dropped
+		NMEA_ParserReset(parser);
+		parser->state = NMEA_STATE_FIELDS;
+		return GPS_CHR_RECEIVED;
+	}
+
+	// ignore everything between sentences (e.g. line feed)
+	if (parser->state == NMEA_STATE_IDLE)
+		return GPS_CHR_RECEIVED;
+
+	if (++parser->length > GPS_MESSAGE_SIZE) {
+		parser->state = NMEA_STATE_IDLE;
+		return GPS_BUF_FULL;
+	}
+
+	if (c == '\r') {
+		// carriage return (\r) is the end of the message
+		parser->state = NMEA_STATE_IDLE;
+
+		if (parser->checksum_digits != 2 || parser->checksum != parser->received_checksum)
+			return GPS_MESSAGE_INVALID;
+
+		return GPS_MSG_CPLT;
+	}
+
+	// line noise; no point in parsing the rest of the sentence
+	if (c < ' ' || c > '~') {
+		parser->state = NMEA_STATE_IDLE;
+		return GPS_MESSAGE_INVALID;
+	}
+
+	if (parser->state == NMEA_STATE_FIELDS) {
+		if (c == ',' || c == '*') {
+			nmea_field_end(parser);
+
+			if (c == '*')
+				parser->state = NMEA_STATE_CHECKSUM;
+			else 
+				parser->checksum ^= (uint8_t)c;
+		}
+		else if (parser->field_len < GPS_FIELD_SIZE - 1) {
+			parser->field[parser->field_len++] = c;
+			parser->checksum ^= (uint8_t)c;
+
+			if (parser->field_idx == 0)
+				parser->address = (parser->address << 8) | (uint8_t)c;
+		}
+		else {
+			parser->state = NMEA_STATE_IDLE;
+			return GPS_BUF_FULL;
+		}
+	}
+	else {
+		// checksum; two hex digits
+		uint8_t digit;
+
+		if (c >= '0' && c <= '9')
+			digit = c - '0';
+		else if (c >= 'A' && c <= 'F')
+			digit = c - 'A' + 10;
+		else if (c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else 
+			digit = 0xFF;
+
+		if (digit == 0xFF || parser->checksum_digits >= 2) {
+			parser->state = NMEA_STATE_IDLE;
+			return GPS_MESSAGE_INVALID;
+		}
+
+		parser->received_checksum = (parser->received_checksum << 4) | digit;
+		parser->checksum_digits++;
+	}
+
+	return GPS_CHR_RECEIVED;
+}
+
+
+/**
+ * @brief Take plain field chars of the sentence 4 at a time (fast path of NMEA_ParseChar)
+ * 
+ * Stops before the first word which contains a delimiter or any other
+ *  special char, or which would not fit the field; the rest must be
+ *  passed to NMEA_ParseChar(...), which gives the same result
+ * 
+ * @param parser: Pointer to NMEA parser state
+ * @param data: Pointer to received chars (no alignment required)
+ * @param len: Number of chars in data
+ * 
+ * @retval (uint16_t) number of chars taken (multiple of 4, may be 0)
+*/
+uint16_t NMEA_ParseRun(struct NMEA_Parser *parser, const char *data, uint16_t len)
+{
+	uint32_t checksum = 0;
+	uint16_t taken = 0;
+
+	// address field is packed char by char, see NMEA_ParseChar
+	if (parser->state != NMEA_STATE_FIELDS || parser->field_idx == 0)
+		return 0;
+
+	while (len - taken >= 4 && parser->field_len + 4 < GPS_FIELD_SIZE && 
+	       parser->length + 4 <= GPS_MESSAGE_SIZE) {
+		uint32_t word;
+
+		// compiles to single (unaligned) load on Cortex-M3
+		memcpy(&word, data + taken, 4);
+		if (nmea_special_chars(word))
+			break;
+
+		memcpy(parser->field + parser->field_len, &word, 4);
+		parser->field_len += 4;
+		parser->length += 4;
+		checksum ^= word;
+		taken += 4;
+	}
+
+	// XOR of the 4 bytes of the word
+	checksum ^= checksum >> 16;
+	checksum ^= checksum >> 8;
+	parser->checksum ^= (uint8_t)checksum;
+
+	return taken;
+}
+
+
+/**
+ * INTERNAL FUNCTION 
+ * 
+ * @brief Use completed UBX frame; store navigation info or acknowledgement of configuration
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * 
+ * @retval Status Code
+*/
+uint8_t ubx_calc_info(struct NEO6 *gps)
+{
+	struct UBX_Parser *ubx = &gps->ubx;
+
+	if (ubx->msg_class == UBX_CLASS_ACK) {
+		if (gps->com.ack_state == GPS_ACK_PENDING && ubx->length >= 2 && 
+		    ubx->payload[0] == gps->com.ack_class && ubx->payload[1] == gps->com.ack_id)
+			gps->com.ack_state = (ubx->msg_id == UBX_ACK_ACK) ? GPS_ACK_RECEIVED : GPS_NAK_RECEIVED;
+
+		return GPS_OK;
+	}
+
+	if (ubx->msg_class == UBX_CLASS_AID) {
+		struct NEO6_WarmData *warm = gps->com.warm;
+
+		if (warm != NULL && ubx->msg_id == UBX_AID_EPH) {
+			// only satellites with ephemeris are stored (8 bytes payload without)
+			if (ubx->length == UBX_AID_EPH_SIZE && warm->eph_count < GPS_WARM_MAX_EPH)
+				memcpy(warm->eph[warm->eph_count++], ubx->payload, UBX_AID_EPH_SIZE);
+
+			gps->com.warm_received++;
+		}
+
+		return GPS_OK;
+	}
+
+	if (gps->com.protocol != GPS_PROTOCOL_UBX)
+		return GPS_MESSAGE_INVALID;
+
+	uint8_t result = UBX_MessageParse(ubx, &gps->info);
+
+	// one position per epoch, with quality and velocity of the same epoch
+	if (result == GPS_MSG_CPLT && UBX_EpochStore(ubx, &gps->info)) {
+		gps->fix_tick = HAL_GetTick();
+		NEO6_FilterUpdate(&gps->filter, &gps->info);
+		NEO6_PredictUpdate(&gps->predict, &gps->info, gps->fix_tick);
+	}
+
+	return result;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Check if UBX frames are expected (UBX protocol, or acknowledgement 
+ * 	  or AID-EPH responses awaited in NMEA mode)
+ * 
+ * @retval (uint8_t) 1 if received chars must go through UBX parser first
+*/
+uint8_t neo6_ubx_expected(struct NEO6 *gps)
+{
+	return gps->com.protocol == GPS_PROTOCOL_UBX || gps->com.ack_state == GPS_ACK_PENDING || 
+	       gps->com.warm != NULL;
+}
+
+
+#ifdef GPS_USE_DWT
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Add cycles of storing one completed message to the statistics
+ * 
+ * @retval void
+*/
+void neo6_count_cycles(struct NEO6 *gps, uint32_t cycles)
+{
+	if (cycles < gps->stats.cycles_min)
+		gps->stats.cycles_min = cycles;
+	if (cycles > gps->stats.cycles_max)
+		gps->stats.cycles_max = cycles;
+
+	gps->stats.cycles_total += cycles;
+}
+#endif
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Parse single received char, count sentences and update info on completed sentence
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * @param c: received char (or byte of UBX frame)
+ * 
+ * @retval Status Code (same as NMEA_ParseChar / UBX_ParseByte)
+*/
+uint8_t neo6_receive(struct NEO6 *gps, char c)
+{
+	uint8_t response;
+	uint8_t is_ubx = neo6_ubx_expected(gps);
+
+	gps->stats.bytes++;
+
+	if (is_ubx) {
+		response = UBX_ParseByte(&gps->ubx, (uint8_t)c);
+
+		// while configuring, acknowledgements (and AID responses) are received between NMEA sentences
+		if (gps->com.protocol == GPS_PROTOCOL_NMEA && gps->ubx.state == UBX_STATE_SYNC_1 && 
+		    response == GPS_CHR_RECEIVED) {
+			response = NMEA_ParseChar(&gps->parser, c);
+			is_ubx = 0;
+		}
+	}
+	else 
+		response = NMEA_ParseChar(&gps->parser, c);
+
+	switch (response) {
+	case GPS_MSG_CPLT:
+		gps->stats.accepted++;
+
+		// readers (NEO6_GetFix) retry while seq is odd or has changed
+		gps->seq++;
+		__DMB();
+
+#ifdef GPS_USE_DWT
+		uint32_t start = DWT->CYCCNT;
+#endif
+
+		if (is_ubx)
+			ubx_calc_info(gps);
+		else 
+			calc_info(gps);
+
+#ifdef GPS_USE_DWT
+		neo6_count_cycles(gps, DWT->CYCCNT - start);
+#endif
+
+		__DMB();
+		gps->seq++;
+		break;
+	case GPS_MESSAGE_INVALID:
+		gps->stats.rejected++;
+		break;
+	case GPS_BUF_FULL:
+		gps->stats.overflowed++;
+		break;
+	default:
+		break;
+	}
+
+	return response;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Wake the parsing task (if any) after new chars are stored; called from interrupt
+ * 
+ * @retval void
+*/
+void neo6_notify_task(struct NEO6 *gps)
+{
+#ifdef GPS_USE_FREERTOS
+        BaseType_t woken = pdFALSE;
+
+        if (gps->com.parser_task != NULL) {
+                vTaskNotifyGiveFromISR(gps->com.parser_task, &woken);
+                portYIELD_FROM_ISR(woken);
+        }
+#else
+        (void)gps;
+#endif
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Parse chars written by DMA between dma_tail and given DMA position
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * @param head: Position of DMA in dma_buffer
+ * 
+ * @retval Status Code (same as NEO6_ReceiveBuffer)
+*/
+uint8_t neo6_parse_dma(struct NEO6 *gps, uint16_t head)
+{
+        const char *buffer = (const char *)gps->com.dma_buffer;
+        uint16_t tail = gps->com.dma_tail;
+        uint8_t response = GPS_CHR_RECEIVED;
+
+        if (head > tail) {
+                response = NEO6_ReceiveBuffer(gps, buffer + tail, head - tail);
+        }
+        else if (head < tail) {
+                // DMA wrapped around the end of the buffer
+                if (NEO6_ReceiveBuffer(gps, buffer + tail, GPS_DMA_BUFFER_SIZE - tail) == GPS_MSG_CPLT)
+                        response = GPS_MSG_CPLT;
+                if (NEO6_ReceiveBuffer(gps, buffer, head) == GPS_MSG_CPLT)
+                        response = GPS_MSG_CPLT;
+        }
+
+        gps->com.dma_tail = (head == GPS_DMA_BUFFER_SIZE) ? 0 : head;
+
+        return response;
+}
+
+
+/**
+ * @brief Receive NEO6 GPS information only 1 char over UART; internal function
+ * 
+ * In GPS_PARSE_IN_TASK mode char is only stored to the ring and parsing task is notified
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * 		(used to store info and handle Neo6 GPS device)
+ * 
+ * @retval Status Code(From HAL or GPS)
+*/
+uint8_t NEO6_UART_ReceiveChar(struct NEO6 *gps)
+{
+        if (gps == NULL)
+                return GPS_ERR_NULL_PTR;
+
+        uint8_t response = GPS_CHR_RECEIVED;
+
+        if (gps->com.parse_mode == GPS_PARSE_IN_TASK) {
+                struct NEO6_Ring *ring = &gps->com.ring;
+                uint16_t head = ring->head;
+                uint16_t next = (head + 1) & (GPS_RING_SIZE - 1);
+
+                if (next != ring->tail) {
+                        ring->data[head] = gps->com.rx_char;
+                        // char must be in memory before consumer can see new head
+                        __DMB();
+                        ring->head = next;
+                }
+                else {
+                        gps->stats.dropped++;
+                        response = GPS_BUF_FULL;
+                }
+
+                neo6_notify_task(gps);
+        }
+        else 
+                response = neo6_receive(gps, (char)gps->com.rx_char);
+
+        HAL_UART_Receive_IT(gps->com.uart, &gps->com.rx_char, 1);
+
+
+        return response;
+
+}
+
+
+/**
+ * @brief Parse block of received chars (e.g. from DMA buffer or recorded log)
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * @param data: Pointer to received chars
+ * @param len: Number of chars in data
+ * 
+ * @retval Status Code
+ * 	GPS_MSG_CPLT - at least one sentence is completed
+ * 	GPS_CHR_RECEIVED - otherwise
+*/
+uint8_t NEO6_ReceiveBuffer(struct NEO6 *gps, const char *data, uint16_t len)
+{
+        if (gps == NULL || data == NULL)
+                return GPS_ERR_NULL_PTR;
+
+        uint8_t response = GPS_CHR_RECEIVED;
+
+        for (uint16_t i = 0; i < len; i++) {
+                // plain field chars are taken 4 at a time; delimiters go through neo6_receive
+                if (!neo6_ubx_expected(gps)) {
+                        uint16_t taken = NMEA_ParseRun(&gps->parser, data + i, len - i);
+
+                        gps->stats.bytes += taken;
+                        i += taken;
+                        if (i >= len)
+                                break;
+                }
+
+                if (neo6_receive(gps, data[i]) == GPS_MSG_CPLT)
+                        response = GPS_MSG_CPLT;
+        }
+
+        return response;
+}
+
+
+/**
+ * @brief Parse chars written by DMA since the last call; used in GPS_RX_MODE_DMA
+ * 
+ * Must be called from HAL_UARTEx_RxEventCallback(...), which is fired on
+ *  half transfer, transfer complete and idle line events
+ * 
+ * In GPS_PARSE_IN_TASK mode DMA position is only stored and parsing task is notified
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * @param size: Position of DMA in dma_buffer (Size argument of the callback)
+ * 
+ * @retval Status Code(From HAL or GPS)
+*/
+uint8_t NEO6_UART_RxEvent(struct NEO6 *gps, uint16_t size)
+{
+        if (gps == NULL)
+                return GPS_ERR_NULL_PTR;
+
+        uint8_t response = GPS_CHR_RECEIVED;
+
+        if (size > GPS_DMA_BUFFER_SIZE)
+                return GPS_MESSAGE_INVALID;
+
+        if (gps->com.parse_mode == GPS_PARSE_IN_TASK) {
+                // end of buffer is stored as 0, same as dma_tail after wrapping
+                gps->com.dma_head = (size == GPS_DMA_BUFFER_SIZE) ? 0 : size;
+                neo6_notify_task(gps);
+        }
+        else 
+                response = neo6_parse_dma(gps, size);
+
+        return response;
+}
+
+
+/**
+ * @brief Count UART error and restart reception; used in GPS_RX_MODE_IT and GPS_RX_MODE_DMA
+ * 
+ * HAL stops reception on overrun (and on noise or framing error with DMA) and 
+ *  reports it only with HAL_UART_ErrorCallback(...), so it must be restarted here
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * 
+ * @retval Status Code(From HAL or GPS); HAL_BUSY if reception was still running
+*/
+uint8_t NEO6_UART_Error(struct NEO6 *gps)
+{
+        if (gps == NULL)
+                return GPS_ERR_NULL_PTR;
+
+        gps->stats.uart_errors++;
+
+        if (gps->com.rx_mode == GPS_RX_MODE_IT)
+                return HAL_UART_Receive_IT(gps->com.uart, &gps->com.rx_char, 1);
+
+        if (gps->com.rx_mode != GPS_RX_MODE_DMA)
+                return GPS_OK;
+
+        // DMA starts again at the beginning of the buffer, message being received is lost;
+        //  in GPS_PARSE_IN_TASK mode the parsing task does the same (see NEO6_Process), as 
+        //  dma_buffer past dma_tail holds the previous lap with complete (old) messages
+        if (gps->com.parse_mode == GPS_PARSE_IN_ISR) {
+                gps->com.dma_tail = 0;
+                NMEA_ParserReset(&gps->parser);
+                UBX_ParserReset(&gps->ubx);
+                UBX_EpochReset(&gps->ubx);
+        }
+        else {
+                gps->com.dma_head = 0;
+                gps->com.dma_restarts++;
+        }
+
+        return HAL_UARTEx_ReceiveToIdle_DMA(gps->com.uart, gps->com.dma_buffer, GPS_DMA_BUFFER_SIZE);
+}
+
+
+/**
+ * @brief Find NEO6 struct initialized with the given UART
+ * 
+ * @param uart_handler: Pointer to UART handle (e.g. huart argument of HAL callback)
+ * 
+ * @retval Pointer to NEO6 struct, NULL if the UART is not used by any
+*/
+struct NEO6 *NEO6_FromUART(UART_HandleTypeDef *uart_handler)
+{
+	for (uint8_t i = 0; i < GPS_MAX_INSTANCES; i++) {
+		if (neo6_instances[i] != NULL && neo6_instances[i]->com.uart == uart_handler)
+			return neo6_instances[i];
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief Dispatch UART receive complete event to the NEO6 struct of the UART (GPS_RX_MODE_IT)
+ * 
+ * @note Call it from HAL_UART_RxCpltCallback(...); other UARTs are ignored
+ * 
+ * @param uart_handler: huart argument of HAL_UART_RxCpltCallback(...)
+ * 
+ * @retval void
+*/
+void NEO6_UART_RxCpltCallback(UART_HandleTypeDef *uart_handler)
+{
+	struct NEO6 *gps = NEO6_FromUART(uart_handler);
+
+	if (gps != NULL && gps->com.rx_mode == GPS_RX_MODE_IT)
+		NEO6_UART_ReceiveChar(gps);
+}
+
+
+/**
+ * @brief Dispatch UART reception event to the NEO6 struct of the UART (GPS_RX_MODE_DMA)
+ * 
+ * @note Call it from HAL_UARTEx_RxEventCallback(...); other UARTs are ignored
+ * 
+ * @param uart_handler: huart argument of HAL_UARTEx_RxEventCallback(...)
+ * @param size: Size argument of HAL_UARTEx_RxEventCallback(...)
+ * 
+ * @retval void
+*/
+void NEO6_UART_RxEventCallback(UART_HandleTypeDef *uart_handler, uint16_t size)
+{
+	struct NEO6 *gps = NEO6_FromUART(uart_handler);
+
+	if (gps != NULL && gps->com.rx_mode == GPS_RX_MODE_DMA)
+		NEO6_UART_RxEvent(gps, size);
+}
+
+
+/**
+ * @brief Dispatch UART error to the NEO6 struct of the UART and restart its reception
+ * 
+ * @note Call it from HAL_UART_ErrorCallback(...); other UARTs are ignored
+ * 
+ * @param uart_handler: huart argument of HAL_UART_ErrorCallback(...)
+ * 
+ * @retval void
+*/
+void NEO6_UART_ErrorCallback(UART_HandleTypeDef *uart_handler)
+{
+	struct NEO6 *gps = NEO6_FromUART(uart_handler);
+
+	if (gps != NULL)
+		NEO6_UART_Error(gps);
+}
+
+
+/**
+ * @brief Parse chars received since the last call (GPS_PARSE_IN_TASK mode)
+ * 
+ * Called from the parsing task (or main loop) after it is notified by 
+ *  NEO6_UART_ReceiveChar(...) or NEO6_UART_RxEvent(...); may be preempted
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * 
+ * @retval Status Code
+ * 	GPS_MSG_CPLT - at least one sentence is completed
+ * 	GPS_CHR_RECEIVED - otherwise
+*/
+uint8_t NEO6_Process(struct NEO6 *gps)
+{
+        if (gps == NULL)
+                return GPS_ERR_NULL_PTR;
+
+        if (gps->com.rx_mode == GPS_RX_MODE_DMA) {
+                uint8_t restarts;
+                uint16_t head;
+
+                // position of the same DMA lap as restarts (UART error may interrupt)
+                do {
+                        restarts = gps->com.dma_restarts;
+                        head = gps->com.dma_head;
+                } while (restarts != gps->com.dma_restarts);
+
+                if (restarts != gps->com.dma_restarts_seen) {
+                        gps->com.dma_restarts_seen = restarts;
+                        gps->com.dma_tail = 0;
+                        NMEA_ParserReset(&gps->parser);
+                        UBX_ParserReset(&gps->ubx);
+                        UBX_EpochReset(&gps->ubx);
+                }
+
+                return neo6_parse_dma(gps, head);
+        }
+
+        struct NEO6_Ring *ring = &gps->com.ring;
+        uint16_t head = ring->head;
+        uint16_t tail = ring->tail;
+        uint8_t response = GPS_CHR_RECEIVED;
+
+        // chars up to head are in memory (see NEO6_UART_ReceiveChar)
+        __DMB();
+
+        while (tail != head) {
+                if (neo6_receive(gps, (char)ring->data[tail]) == GPS_MSG_CPLT)
+                        response = GPS_MSG_CPLT;
+
+                tail = (tail + 1) & (GPS_RING_SIZE - 1);
+                ring->tail = tail;
+        }
+
+        return response;
+}
+
+
+/**
+ * @brief Select context of parsing received chars
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * @param parse_mode: GPS_PARSE_IN_ISR or GPS_PARSE_IN_TASK
+ * 
+ * @note In GPS_PARSE_IN_TASK mode NEO6_Process(...) must be called when
+ * 	 new chars are received (see NEO6_Task(...) with FreeRTOS)
+ * 
+ * @retval Status Code
+*/
+uint8_t NEO6_SetParseMode(struct NEO6 *gps, uint8_t parse_mode)
+{
+        if (gps == NULL)
+                return GPS_ERR_NULL_PTR;
+
+        if (parse_mode != GPS_PARSE_IN_ISR && parse_mode != GPS_PARSE_IN_TASK)
+                return GPS_MESSAGE_INVALID;
+
+        // nothing is waiting in the ring or DMA buffer for the new context
+        gps->com.ring.tail = gps->com.ring.head;
+        gps->com.dma_head = gps->com.dma_tail;
+        gps->com.dma_restarts_seen = gps->com.dma_restarts;
+        gps->com.parse_mode = parse_mode;
+
+        return GPS_OK;
+}
+
+
+#ifdef GPS_USE_FREERTOS
+/**
+ * @brief GPS parsing task; parses received chars whenever it is notified by UART interrupt
+ * 
+ * @param argument: Pointer to NEO6 GPS struct, initialized by NEO6_Init(...) or NEO6_InitDMA(...)
+ * 
+ * @note Usage: xTaskCreate(NEO6_Task, "gps", 256, &gps, priority, NULL);
+ * 
+ * @retval void
+*/
+void NEO6_Task(void *argument)
+{
+        struct NEO6 *gps = (struct NEO6 *)argument;
+
+        gps->com.parser_task = xTaskGetCurrentTaskHandle();
+        NEO6_SetParseMode(gps, GPS_PARSE_IN_TASK);
+
+        for (;;) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                NEO6_Process(gps);
+        }
+}
+#endif
+
+
+/**
+ * @brief Select protocol of messages sent by the module
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * @param protocol: GPS_PROTOCOL_NMEA or GPS_PROTOCOL_UBX
+ * 
+ * @note Module must be configured to output the same protocol
+ * 	 (NAV-POSLLH, NAV-SOL, NAV-VELNED and NAV-TIMEUTC messages for UBX)
+ * 
+ * @retval Status Code
+*/
+uint8_t NEO6_SetProtocol(struct NEO6 *gps, uint8_t protocol)
+{
+	if (gps == NULL)
+		return GPS_ERR_NULL_PTR;
+
+	if (protocol != GPS_PROTOCOL_NMEA && protocol != GPS_PROTOCOL_UBX)
+		return GPS_MESSAGE_INVALID;
+
+	gps->com.protocol = protocol;
+	NMEA_ParserReset(&gps->parser);
+	UBX_ParserReset(&gps->ubx);
+	UBX_EpochReset(&gps->ubx);
+
+	return GPS_OK;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Send UBX message to the module and optionally wait for its acknowledgement
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * @param wait_ack: 0 - only send, otherwise wait GPS_ACK_TIMEOUT ms for UBX-ACK
+ * 
+ * @retval Status Code (HAL_TIMEOUT if no acknowledgement, GPS_CFG_NAK if rejected)
+*/
+uint8_t ubx_send(struct NEO6 *gps, uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length, uint8_t wait_ack)
+{
+	uint8_t frame[UBX_AID_EPH_SIZE + UBX_FRAME_OVERHEAD];
+	uint16_t size;
+	uint32_t baudrate;
+	uint8_t result;
+
+	if (gps->com.uart == NULL || length > UBX_AID_EPH_SIZE)
+		return HAL_ERROR;
+
+	size = UBX_BuildFrame(frame, msg_class, msg_id, payload, length);
+	// 10 bits per byte; long frames (AID-EPH) take longer than GPS_TX_TIMEOUT at 9600 Bd
+	baudrate = gps->com.uart->Init.BaudRate ? gps->com.uart->Init.BaudRate : 9600;
+
+	gps->com.ack_class = msg_class;
+	gps->com.ack_id = msg_id;
+	gps->com.ack_state = wait_ack ? GPS_ACK_PENDING : GPS_ACK_NONE;
+
+	result = HAL_UART_Transmit(gps->com.uart, frame, size, GPS_TX_TIMEOUT + size * 10000UL / baudrate);
+	if (result != HAL_OK || !wait_ack) {
+		gps->com.ack_state = GPS_ACK_NONE;
+		return result;
+	}
+
+	uint32_t start = HAL_GetTick();
+	while (gps->com.ack_state == GPS_ACK_PENDING && HAL_GetTick() - start < GPS_ACK_TIMEOUT)
+		;
+
+	if (gps->com.ack_state == GPS_ACK_RECEIVED)
+		result = GPS_OK;
+	else if (gps->com.ack_state == GPS_NAK_RECEIVED)
+		result = GPS_CFG_NAK;
+	else 
+		result = HAL_TIMEOUT;
+
+	gps->com.ack_state = GPS_ACK_NONE;
+	return result;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Set output rate of the message on the current port (UBX-CFG-MSG)
+ * 
+ * @retval Status Code
+*/
+uint8_t ubx_set_msg_rate(struct NEO6 *gps, uint8_t msg_class, uint8_t msg_id, uint8_t rate)
+{
+	uint8_t payload[3] = { msg_class, msg_id, rate };
+
+	return ubx_send(gps, UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload), 1);
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief (Re)start UART reception in the selected reception mode
+ * 
+ * @retval Status Code (From HAL)
+*/
+uint8_t neo6_start_reception(struct NEO6 *gps)
+{
+	NMEA_ParserReset(&gps->parser);
+	UBX_ParserReset(&gps->ubx);
+	UBX_EpochReset(&gps->ubx);
+
+	if (gps->com.rx_mode == GPS_RX_MODE_DMA) {
+		gps->com.dma_tail = 0;
+		gps->com.dma_head = 0;
+		gps->com.dma_restarts_seen = gps->com.dma_restarts;
+		return HAL_UARTEx_ReceiveToIdle_DMA(gps->com.uart, gps->com.dma_buffer, GPS_DMA_BUFFER_SIZE);
+	}
+
+	return HAL_UART_Receive_IT(gps->com.uart, &gps->com.rx_char, 1);
+}
+
+
+/**
+ * @brief Configure the module: output messages, navigation rate and baudrate
+ * 	  (must be called after NEO6_Init(...) or NEO6_InitDMA(...))
+ * 
+ * Every message and rate setting is checked for UBX-ACK; baudrate is changed 
+ *  last, without acknowledgement, as the module switches to the new baudrate immediately
+ * 
+ * NMEA sentences are enabled for the subscribed fields (see NEO6_Subscribe(...)),
+ *  so it should be called again after the subscription changes
+ * 
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param cfg: Pointer to desired configuration
+ * 
+ * @note Blocks for up to GPS_ACK_TIMEOUT ms per setting; UART interrupts must be enabled
+ * 	 and received chars must be parsed meanwhile (call it before NEO6_Task(...) is started)
+ * 
+ * @retval Status Code
+*/
+uint8_t NEO6_Configure(struct NEO6 *gps, const struct NEO6_Config *cfg)
+{
+	static const uint8_t nmea_ids[] = { 
+		UBX_NMEA_GGA, UBX_NMEA_GLL, UBX_NMEA_GSA, UBX_NMEA_GSV, UBX_NMEA_RMC, UBX_NMEA_VTG 
+	};
+	static const uint8_t ubx_ids[] = { UBX_NAV_POSLLH, UBX_NAV_SOL, UBX_NAV_VELNED, UBX_NAV_TIMEUTC };
+	uint8_t nmea = (cfg != NULL && cfg->protocol == GPS_PROTOCOL_NMEA);
+	uint8_t result = GPS_OK;
+
+	if (gps == NULL || cfg == NULL)
+		return GPS_ERR_NULL_PTR;
+
+	// nothing to send commands to
+	if (gps->com.rx_mode == GPS_RX_MODE_NONE)
+		return HAL_ERROR;
+
+	// NMEA output: only GGA and RMC, GSA for PDOP/VDOP (and used satellites), GSV for satellite table
+	for (uint8_t i = 0; i < sizeof(nmea_ids) && result == GPS_OK; i++) {
+		uint8_t used = (nmea_ids[i] == UBX_NMEA_GGA || nmea_ids[i] == UBX_NMEA_RMC || 
+				((gps->parser.subscribed & (GPS_FIELD_DOP | GPS_FIELD_SATS)) && nmea_ids[i] == UBX_NMEA_GSA) ||
+				((gps->parser.subscribed & GPS_FIELD_SATS) && nmea_ids[i] == UBX_NMEA_GSV));
+		result = ubx_set_msg_rate(gps, UBX_CLASS_NMEA, nmea_ids[i], (nmea && used) ? 1 : 0);
+	}
+
+	// UBX output: navigation messages
+	for (uint8_t i = 0; i < sizeof(ubx_ids) && result == GPS_OK; i++)
+		result = ubx_set_msg_rate(gps, UBX_CLASS_NAV, ubx_ids[i], nmea ? 0 : 1);
+
+	// Navigation rate (UBX-CFG-RATE): measRate, navRate = 1, timeRef = GPS time
+	if (result == GPS_OK && cfg->rate_ms) {
+		uint8_t payload[6] = { 
+			(uint8_t)cfg->rate_ms, (uint8_t)(cfg->rate_ms >> 8), 
+			0x01, 0x00, 
+			0x01, 0x00 
+		};
+		result = ubx_send(gps, UBX_CLASS_CFG, UBX_CFG_RATE, payload, sizeof(payload), 1);
+	}
+
+	if (result != GPS_OK)
+		return result;
+
+	NEO6_SetProtocol(gps, cfg->protocol);
+
+	// Port settings (UBX-CFG-PRT): UART1, 8N1, UBX+NMEA input, selected protocol output
+	if (cfg->baudrate && cfg->baudrate != gps->com.uart->Init.BaudRate) {
+		// UBX output is kept in NMEA mode too, acknowledgements are UBX messages
+		uint8_t out_proto = nmea ? 0x03 : 0x01;
+		uint8_t payload[20] = {
+			0x01, 0x00, 0x00, 0x00,
+			0xD0, 0x08, 0x00, 0x00,
+			(uint8_t)cfg->baudrate, (uint8_t)(cfg->baudrate >> 8), 
+			(uint8_t)(cfg->baudrate >> 16), (uint8_t)(cfg->baudrate >> 24),
+			0x03, 0x00, 
+			out_proto, 0x00, 
+			0x00, 0x00, 0x00, 0x00 
+		};
+
+		result = ubx_send(gps, UBX_CLASS_CFG, UBX_CFG_PRT, payload, sizeof(payload), 0);
+		if (result != HAL_OK)
+			return result;
+
+		// let the last byte leave the shift register before switching
+		HAL_Delay(GPS_TX_TIMEOUT);
+
+		HAL_UART_AbortReceive(gps->com.uart);
+		gps->com.uart->Init.BaudRate = cfg->baudrate;
+		result = HAL_UART_Init(gps->com.uart);
+		if (result != HAL_OK)
+			return result;
+
+		result = neo6_start_reception(gps);
+		if (result != HAL_OK)
+			return result;
+	}
+
+	return GPS_OK;
+}
+
+
+/**
+ * @brief Parse NMEA Message (GGA, RMC, VTG and GSA)
+ * 	  messages with wrong or missing checksum are treated as unknown ones
+ * 
+ * @param message: Pointer to cstring which contains received & parsed, single NMEA message
+ * @param info: Pointer to NEO6 gps info struct to store parsed information
+ * 
+ * @retval void
+*/
+void NMEA_MessageParse(char *message, struct NEO6_ParsedInfo *info)
+{
+	struct NMEA_Parser parser;
+	uint8_t response = GPS_CHR_RECEIVED;
+
+	NMEA_ParserReset(&parser);
+	NMEA_Subscribe(&parser, GPS_FIELD_ALL);
+
+	while (*message && response == GPS_CHR_RECEIVED)
+		response = NMEA_ParseChar(&parser, *message++);
+
+	// message may be passed without trailing '\r'
+	if (response == GPS_CHR_RECEIVED)
+		response = NMEA_ParseChar(&parser, '\r');
+
+	if (response == GPS_MSG_CPLT && parser.sentence != NMEA_SENTENCE_UNKNOWN) {
+		*info = parser.info;
+
+		if (parser.time_of_day != UINT32_MAX) {
+			info->utc_time = (uint32_t)parser.date * 86400 + parser.time_of_day / 1000;
+			info->utc_ms = parser.time_of_day % 1000;
+		}
+		return ;
+	}
+
+	nmea_info_clear(info);
+}
+
+
+/**
+ * @brief Print Parsed GPS Info
+ * 
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * 
+ * @retval void
+*/
+void NEO6_PrintInfo(struct NEO6 *gps)
+{
+	if (gps->info.quality){
+		char location[GPS_LOCATION_SIZE];
+		char text[GPS_DATETIME_SIZE];
+
+		printf("Your Location: %s\n\r", NEO6_GetLocation(gps, location, sizeof(location)));
+		printf("Your Altitude: %s%ld.%03ldm\n\r", (gps->info.pos.alt < 0) ? "-" : "", 
+			labs(gps->info.pos.alt) / GPS_ALT_SCALE, labs(gps->info.pos.alt) % GPS_ALT_SCALE);
+		printf("Date & time: %s\n\r", NEO6_GetDateTime(gps, text, sizeof(text)));
+		printf("---------------------------------------------\n\r");
+	}
+}
+
+
+/**
+ * @brief Copy received information without locking out reception (seqlock read)
  * 
- * @brief Tokenize given "str" string based on characters in "delim" string
- * Difference between strtok(...) function and this one is that,
- *  strtoke(...) takes empty strings between consecutive "delim" characters into account, too.
+ * Copy is retried if the information was updated meanwhile, so all fields 
+ *  of the copy belong to the same update
  * 
- * Found on: https://github.com/lamik/GPS_NEO6_STM32_HAL/blob/master/Src/gps_neo6.c
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param fix: Pointer to struct to store the copy
  * 
- * @param str: pointer to cstring to tokenize
- * @param delim: pointer to cstring for specifying delimiter characters
+ * @note If parsing runs in a lower priority task (GPS_PARSE_IN_TASK), it may be 
+ * 	 preempted in the middle of an update; HAL_BUSY is returned then
  * 
- * @retval (char *) Pointer to the beginning of tokenized string 
+ * @retval Status Code (GPS_OK or HAL_BUSY)
 */
-char* strtoke(char *str, const char *delim)
+uint8_t NEO6_GetFix(struct NEO6 *gps, struct NEO6_Fix *fix)
 {
-        static char *start = NULL; /* stores string str for consecutive calls */
-        char *token = NULL; /* found token */
-
-        /* assign new start in case */
-        if (str) start = str;
-
-        /* check whether text to parse left */
-        if (!start) return NULL;
-
-        /* remember current start as found token */
-        token = start;
-
-        /* find next occurrence of delim */
-        start = strpbrk(start, delim);
-
-        /* replace delim with terminator and move start to follower */
-        if (start) *start++ = '\0';
+	if (gps == NULL || fix == NULL)
+		return GPS_ERR_NULL_PTR;
+
+	for (uint8_t attempt = 0; attempt < GPS_SNAPSHOT_RETRIES; attempt++) {
+		uint32_t seq = gps->seq;
+
+		// update in progress
+		if (seq & 1)
+			continue;
+
+		__DMB();
+		fix->info = gps->info;
+		fix->filtered = gps->filter.pos;
+		fix->filtered_count = gps->filter.count;
+		fix->predict = gps->predict;
+		uint32_t fix_tick = gps->fix_tick;
+		__DMB();
+
+		if (seq == gps->seq) {
+			fix->age_ms = fix->info.quality ? HAL_GetTick() - fix_tick : UINT32_MAX;
+			return GPS_OK;
+		}
+	}
 
-        /* done */
-        return token;
+	return HAL_BUSY;
 }
 
 
 /**
- * INTERNAL FUNCTION 
+ * @brief Collect health of the receive path (counters, rates, timing, fix age) for telemetry
  * 
- * @brief Calculate or extract useful information from received NMEA messages 
+ * Rates are averaged since the previous call, so it should be called 
+ *  periodically from a single task (e.g. once per telemetry packet)
  * 
- * @param gps: Pointer to GPS configuration and received-information struct
- * 		(used to store info and handle Neo6 GPS device)
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param health: Pointer to struct to store health
  * 
  * @retval Status Code
- * 
 */
-uint8_t calc_info(struct NEO6 *gps)
-{       
-	// Parse every received message
-        for (uint8_t m = 0; m < GPS_BUFFER_SIZE; m++){
-
-		struct NEO6_ParsedInfo info = {
-			{
-				0,     // latitude value
-				'0',   // latitude direction
-				0,     // longtitude value
-				'0',   // longtitude direction
-				0      // altitude 
-			},
-			"",            // UTC time
-			"",            // UTC date
-			0              // Quality of info 
-		};
-                
+uint8_t NEO6_GetHealth(struct NEO6 *gps, struct NEO6_Health *health)
+{
+	struct NEO6_Fix fix;
+	uint32_t now, elapsed, messages;
+	uint32_t primask, timed;
+	uint64_t cycles_total;
+
+	if (gps == NULL || health == NULL)
+		return GPS_ERR_NULL_PTR;
+
+	now = HAL_GetTick();
+	elapsed = now - gps->stats.rate_tick;
+
+	// counters are updated by the parser at any time; each one is read once
+	health->bytes = gps->stats.bytes;
+	health->accepted = gps->stats.accepted;
+	health->rejected = gps->stats.rejected;
+	health->overflowed = gps->stats.overflowed;
+	health->dropped = gps->stats.dropped;
+	health->uart_errors = gps->stats.uart_errors;
+	health->outliers = gps->filter.outliers;
+
+	messages = health->accepted - gps->stats.rate_accepted;
+	if (elapsed) {
+		uint32_t bytes_per_s = (uint32_t)((uint64_t)(health->bytes - gps->stats.rate_bytes) * 1000 / elapsed);
+		uint32_t messages_per_s = (uint32_t)((uint64_t)messages * 1000 / elapsed);
+
+		health->bytes_per_s = (bytes_per_s > UINT16_MAX) ? UINT16_MAX : bytes_per_s;
+		health->messages_per_s = (messages_per_s > UINT16_MAX) ? UINT16_MAX : messages_per_s;
+	}
+	else {
+		health->bytes_per_s = 0;
+		health->messages_per_s = 0;
+	}
 
-		char *message = gps->com.messages_buffer[m];
-		// printf("%s\n\r",  message);
-		NMEA_MessageParse(message, &info);
+	gps->stats.rate_bytes = health->bytes;
+	gps->stats.rate_accepted = health->accepted;
+	gps->stats.rate_tick = now;
 
-		gps->info.quality = info.quality;
-		if (info.quality){
-			gps->info.pos.lat = info.pos.lat;
-			gps->info.pos.lat_dir = info.pos.lat_dir;
+	// zero when GPS_USE_DWT is not defined (no message was timed)
+	health->cycles_min = (gps->stats.cycles_min == UINT32_MAX) ? 0 : gps->stats.cycles_min;
+	health->cycles_max = gps->stats.cycles_max;
 
-			gps->info.pos.lon = info.pos.lon;
-			gps->info.pos.lon_dir = info.pos.lon_dir;
+	// 64-bit total is not read atomically; mask the parser (UART interrupt) meanwhile
+	primask = __get_PRIMASK();
+	__disable_irq();
+	cycles_total = gps->stats.cycles_total;
+	timed = gps->stats.accepted;
+	__set_PRIMASK(primask);
 
-			sprintf(gps->info.utc_time, "%s", info.utc_time);
+	health->cycles_avg = timed ? (uint32_t)(cycles_total / timed) : 0;
 
-			if (strlen(info.date)) 
-				sprintf(gps->info.date, "%s", info.date);
-			
-			if (info.pos.alt)
-				gps->info.pos.alt = info.pos.alt;
-			break;
-		}
-	}
+	health->fix_age_ms = (NEO6_GetFix(gps, &fix) == GPS_OK) ? fix.age_ms : UINT32_MAX;
 
-	gps->com.buffer_tail = 0;
-        gps->com.message_tail = 0;
-        return 0;
+	return GPS_OK;
 }
 
+
 /**
- * INTERNAL FUNCTION
+ * @brief Format health as compact text for telemetry
+ * 	  "bytes/s,msgs/s,accepted,rejected,overflowed,dropped,uart errors,cycles min/avg/max,fix age ms"
  * 
- * Parse GPGGA function
+ * @param health: Pointer to health from NEO6_GetHealth(...)
+ * @param text: Pointer to buffer to store text, GPS_HEALTH_SIZE is enough
+ * @param size: Size of buffer
  * 
+ * @retval (char*) text
 */
-void NMEA_GPGGAParse(struct NEO6_ParsedInfo *info)
+char *NEO6_HealthToString(const struct NEO6_Health *health, char *text, uint8_t size)
 {
-	char *parsed_token;
-
-	// Time of fix
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0){
-		uint32_t time = atoi(parsed_token);
-		sprintf(info->utc_time, "%02lu:%02lu:%02lu", (time/10000) % 100, (time / 100) % 100, time % 100);
-	}
-
-	// Latitude (value and direction)
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0){
-		// latitude value
-		double lat_deg = (atoi(parsed_token) / 100) % 100; 
-		double lat_min = atof(parsed_token) - lat_deg*100;
-		info->pos.lat = lat_deg + lat_min / 60;
-
-		// latitude direction
-		parsed_token = strtoke(NULL, ",*");
-		info->pos.lat_dir = *parsed_token;  
-
-	} else strtoke(NULL, ",*"); // jump over empty latitude direction
-
-	// Longtitude (value and direction)
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0) {
-		// longtitude value
-		double lon_deg = (atoi(parsed_token) / 100) % 100; 
-		double lon_min = atof(parsed_token) - lon_deg*100;
-		info->pos.lon = lon_deg + lon_min / 60;
+	if (!size)
+		return text;
 
-		// longtitude direction
-		parsed_token = strtoke(NULL, ",*");
-		info->pos.lon_dir = *parsed_token;
+	snprintf(text, size, "%u,%u,%lu,%lu,%lu,%lu,%lu,%lu/%lu/%lu,%ld", 
+		health->bytes_per_s, health->messages_per_s, 
+		(unsigned long)health->accepted, (unsigned long)health->rejected, (unsigned long)health->overflowed, 
+		(unsigned long)health->dropped, (unsigned long)health->uart_errors, 
+		(unsigned long)health->cycles_min, (unsigned long)health->cycles_avg, (unsigned long)health->cycles_max, 
+		(health->fix_age_ms == UINT32_MAX) ? -1L : (long)health->fix_age_ms);
 
-	} else strtoke(NULL, ",*"); // jump over empty longtitude direction
-
-	// Quality of fix
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0) {
-		info->quality = (uint8_t)atoi(parsed_token);
-	}
-
-	// Number of sattellites
-	strtoke(NULL, ",*");
-
-	// HDOP
-	strtoke(NULL, ",*");
-
-	// Altitutde
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0) {
-		info->pos.alt = atof(parsed_token);
-	}
-	return ;
+	return text;
 }
 
+
 /**
- * INTERNAL FUNCTION 
+ * @brief Add groups of fields converted by the parser (all but GPS_FIELD_SATS after init)
  * 
- * Parse GPRMC message
+ * Fields of other groups are skipped without conversion and keep their last 
+ *  values in gps->info; sentences without subscribed fields are skipped whole
+ * 
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param fields: GPS_FIELD_* groups (e.g. GPS_FIELD_POSITION | GPS_FIELD_ALTITUDE)
+ * 
+ * @retval Status Code
 */
-void NMEA_GPRMCParse(struct NEO6_ParsedInfo *info)
+uint8_t NEO6_Subscribe(struct NEO6 *gps, uint16_t fields)
 {
-	char *parsed_token;
-
-	// Time of FIX
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0) {
-		uint32_t time = atoi(parsed_token);
-		sprintf(info->utc_time, "%02lu:%02lu:%02lu", (time/10000) % 100, (time / 100) % 100, time % 100);
-	}
-
-	// Quality of Data
-	parsed_token = strtoke(NULL, ",*");
-	if ((strlen(parsed_token) > 0)){
-		if (!strcmp(parsed_token, "V"))
-			info->quality = 0;
-		else 
-			info->quality = 1;
-	}
-
-	// Latitude (value and direction)
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0){
-		// latitude value
-		double lat_deg = (atoi(parsed_token) / 100) % 100; 
-		double lat_min = atof(parsed_token) - lat_deg*100;
-		info->pos.lat = lat_deg + lat_min / 60;
-
-		// latitude direction
-		parsed_token = strtoke(NULL, ",*");
-		info->pos.lat_dir = *parsed_token;  
-
-	} else strtoke(NULL, ",*"); // jump over empty latitude direction
+	if (gps == NULL)
+		return GPS_ERR_NULL_PTR;
 
-	// Longtitude (value and direction)
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0) {
-		// longtitude value
-		double lon_deg = (atoi(parsed_token) / 100) % 100; 
-		double lon_min = atof(parsed_token) - lon_deg*100;
-		info->pos.lon = lon_deg + lon_min / 60;
+	NMEA_Subscribe(&gps->parser, gps->parser.subscribed | fields);
 
-		// longtitude direction
-		parsed_token = strtoke(NULL, ",*");
-		info->pos.lon_dir = *parsed_token;
-
-	} else strtoke(NULL, ",*"); // jump over empty longtitude direction
-
-	// Speed over ground 
-	strtoke(NULL, ",*");
+	return GPS_OK;
+}
 
-	// Course over ground
-	strtoke(NULL, ",*");
 
-	// UTC date of FIX
-	parsed_token = strtoke(NULL, ",*");
-	if (strlen(parsed_token) > 0) {
-		uint32_t date = atoi(parsed_token);
-		sprintf(info->date, "%02lu.%02lu.20%lu", (date / 10000) % 100, (date / 100) % 100, date % 100);
-	}
+/**
+ * @brief Remove groups of fields nobody reads, see NEO6_Subscribe(...)
+ * 
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param fields: GPS_FIELD_* groups (quality of fix is always converted)
+ * 
+ * @note UBX messages are decoded whole regardless of subscription
+ * 
+ * @retval Status Code
+*/
+uint8_t NEO6_Unsubscribe(struct NEO6 *gps, uint16_t fields)
+{
+	if (gps == NULL)
+		return GPS_ERR_NULL_PTR;
 
-	return ;
+	NMEA_Subscribe(&gps->parser, gps->parser.subscribed & ~fields);
 
+	return GPS_OK;
 }
 
 
-/** --------------------------- LIBRARY FUNCTIONS --------------------------- **/
-
 /**
- * @brief Receive NEO6 GPS information only 1 char over UART; internal function
+ * @brief Enable or disable satellite table (GSV satellites in view, GSA satellites used in fix)
  * 
- * @param gps: Pointer to GPS configuration and received-information struct
- * 		(used to store info and handle Neo6 GPS device)
+ * Disabled table costs nothing; GSV sentences are skipped as unknown
  * 
- * @retval Status Code(From HAL or GPS)
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param enable: 1 to enable, 0 to disable
+ * 
+ * @note NEO6_Configure(...) turns GSA and GSV output on only if the table is enabled
+ * 
+ * @retval Status Code
 */
-uint8_t NEO6_UART_ReceiveChar(struct NEO6 *gps)
+uint8_t NEO6_SatTableEnable(struct NEO6 *gps, uint8_t enable)
 {
-        if (gps == NULL)
-                return GPS_ERR_NULL_PTR;
-
-        uint8_t response; 
-
-        if (gps->com.buffer_tail < 0){
-                // buffer is full
-                // calculate info and clear the buffer
-                calc_info(gps);
-                response = (uint8_t)GPS_BUF_FULL;
-        }
-        else {
-                if (UART_ReceivedChar == 13){
-                        // if carriage return (\r) is received then it means the end of the message 
-                        gps->com.messages_buffer[gps->com.buffer_tail][gps->com.message_tail] = '\0';
-                        
-                        if (gps->com.buffer_tail < GPS_BUFFER_SIZE - 1)
-                                gps->com.buffer_tail++;
-                        else 
-                                gps->com.buffer_tail = -1;
-                        
-                        gps->com.message_tail = 0;
+	if (gps == NULL)
+		return GPS_ERR_NULL_PTR;
 
-                        response = GPS_MSG_CPLT;
+	// table is filled again by the next GSV sequence
+	if (enable)
+		NEO6_Subscribe(gps, GPS_FIELD_SATS);
+	else 
+		NEO6_Unsubscribe(gps, GPS_FIELD_SATS);
+	memset(&gps->sats, 0, sizeof(gps->sats));
 
-                }
-                else if (UART_ReceivedChar == 10 || UART_ReceivedChar == 0){
-                        // ignore the line feed (\n) character
-                        response = (uint8_t)GPS_CHR_RECEIVED;
+	return GPS_OK;
+}
 
-                }
-                else {
-                        gps->com.messages_buffer[gps->com.buffer_tail][gps->com.message_tail] = UART_ReceivedChar;
-                        gps->com.message_tail++;
 
-                        response = (uint8_t)GPS_CHR_RECEIVED;
+/**
+ * @brief Copy satellite table consistently (same as NEO6_GetFix(...))
+ * 
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param table: Pointer to struct to store the copy
+ * 
+ * @retval Status Code (GPS_OK or HAL_BUSY)
+*/
+uint8_t NEO6_GetSatellites(struct NEO6 *gps, struct NEO6_SatTable *table)
+{
+	if (gps == NULL || table == NULL)
+		return GPS_ERR_NULL_PTR;
 
-                }
-        }
+	for (uint8_t attempt = 0; attempt < GPS_SNAPSHOT_RETRIES; attempt++) {
+		uint32_t seq = gps->seq;
 
-        HAL_UART_Receive_IT(gps->com.uart, (uint8_t*)&UART_ReceivedChar, 1);
+		if (seq & 1)
+			continue;
 
+		__DMB();
+		*table = gps->sats;
+		__DMB();
 
-        return response;
+		if (seq == gps->seq)
+			return GPS_OK;
+	}
 
+	return HAL_BUSY;
 }
 
 
 /**
- * @brief Parse NMEA Message (only GPGGA and GPRMC)
+ * @brief Summarize satellite table (counts and SNR) for telemetry
  * 
- * @param message: Pointer to cstring which contains received & parsed, single NMEA message
- * @param info: Pointer to NEO6 gps info struct to store parsed information
+ * @param table: Pointer to satellite table (e.g. copy from NEO6_GetSatellites(...))
+ * @param summary: Pointer to struct to store summary
  * 
  * @retval void
 */
-void NMEA_MessageParse(char *message, struct NEO6_ParsedInfo *info)
+void NEO6_SatSummary(const struct NEO6_SatTable *table, struct NEO6_SatSummary *summary)
 {
-        char *parsed_token;
-        parsed_token = strtoke(message, ",*");
-	
-	if (!strcmp(parsed_token, "$GPGGA") || !strcmp(parsed_token, "$$GPGGA")) {
-		NMEA_GPGGAParse(info);
-        }
+	uint16_t snr_sum = 0;
 
-        else if (!strcmp(parsed_token, "$GPRMC") || !strcmp(parsed_token, "$$GPRMC")) {
-		NMEA_GPRMCParse(info);
-        }
+	summary->in_view = table->in_view;
+	summary->tracked = 0;
+	summary->used = 0;
+	summary->snr_max = 0;
+	summary->snr_min_used = 0;
 
-	else {
-		sprintf(info->utc_time, "00:00:00");
-		sprintf(info->date, "00.00.0000");
+	for (uint8_t i = 0; i < table->count && i < GPS_MAX_SATS; i++) {
+		const struct NEO6_Satellite *sat = &table->sat[i];
 
-		info->quality = 0;
+		if (!sat->snr)
+			continue;
 
-		info->pos.alt = 0;
-		info->pos.lat = 0;
-		info->pos.lat_dir = '0';
-		info->pos.lon = 0;
-		info->pos.lon_dir = '0';
-		return ;
+		summary->tracked++;
+		if (sat->snr > summary->snr_max)
+			summary->snr_max = sat->snr;
 
-	}	
-	
+		if (sat->used) {
+			if (!summary->used || sat->snr < summary->snr_min_used)
+				summary->snr_min_used = sat->snr;
+
+			summary->used++;
+			snr_sum += sat->snr;
+		}
+	}
+
+	summary->snr_avg_used = summary->used ? (uint8_t)(snr_sum / summary->used) : 0;
 }
 
 
 /**
- * @brief Print Parsed GPS Info
+ * @brief Format satellite summary as compact text for telemetry
+ * 	  "in view,tracked,used,SNR max,SNR min/avg of used"
  * 
- * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param summary: Pointer to summary from NEO6_SatSummary(...)
+ * @param text: Pointer to buffer to store text, GPS_SATS_SIZE is enough
+ * @param size: Size of buffer
  * 
- * @retval void
+ * @retval (char*) text
 */
-void NEO6_PrintInfo(struct NEO6 *gps)
+char *NEO6_SatSummaryToString(const struct NEO6_SatSummary *summary, char *text, uint8_t size)
 {
-	if (gps->info.quality){
-		printf("Your Location: %f %c, %f %c\n\r", gps->info.pos.lat, gps->info.pos.lat_dir, gps->info.pos.lon, gps->info.pos.lon_dir);
-		printf("Your Altitude: %fm\n\r", gps->info.pos.alt);
-		printf("Date: %s\n\r", gps->info.date);
-		printf("UTC time: %s\n\r", gps->info.utc_time);
-		printf("---------------------------------------------\n\r");
-	}
+	if (!size)
+		return text;
+
+	snprintf(text, size, "%u,%u,%u,%u,%u/%u", 
+		summary->in_view, summary->tracked, summary->used, 
+		summary->snr_max, summary->snr_min_used, summary->snr_avg_used);
+
+	return text;
 }
 
 
@@ -365,18 +2008,23 @@ void NEO6_PrintInfo(struct NEO6 *gps)
  * @brief Return latitude and longtitude in one string from obtained data
  * 
  * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param location: Pointer to buffer for the string (GPS_LOCATION_SIZE chars is enough)
+ * @param size: size of the buffer
  * 
  * @retval Pointer to the beginning of cstring that contains location info
- * 
- * @warning returning cstirng is statically declared, so consecutive 
- * 	    calls to this function will overwrite the same memory spot
+ * 	    (empty if there is no fix)
  * 
 */
-char *NEO6_GetLocation(struct NEO6 *gps)
+char *NEO6_GetLocation(struct NEO6 *gps, char *location, uint8_t size)
 {
-	static char location[30];
+	if (!size)
+		return location;
+
+	location[0] = '\0';
 	if (gps->info.quality)
-		sprintf(location, "%f %c, %f %c", gps->info.pos.lat, gps->info.pos.lat_dir, gps->info.pos.lon, gps->info.pos.lon_dir); 
+		snprintf(location, size, "%ld.%07ld %c, %ld.%07ld %c", 
+			gps->info.pos.lat / GPS_COORD_SCALE, gps->info.pos.lat % GPS_COORD_SCALE, gps->info.pos.lat_dir, 
+			gps->info.pos.lon / GPS_COORD_SCALE, gps->info.pos.lon % GPS_COORD_SCALE, gps->info.pos.lon_dir); 
 
 	return location;
 	
@@ -387,18 +2035,31 @@ char *NEO6_GetLocation(struct NEO6 *gps)
  * 	  format: dd.mm.yyyy hh:mm:ss UTC
  * 
  * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param date_time: Pointer to buffer for the string (GPS_DATETIME_SIZE chars is enough)
+ * @param size: size of the buffer
  * 
  * @retval Pointer to the beginning of cstring that contains date&time info
- * 
- * @warning returning cstirng is statically declared, so consecutive 
- * 	    calls to this function will overwrite the same memory spot
+ * 	    (empty if there is no fix)
  * 
 */
-char *NEO6_GetDateTime(struct NEO6 *gps)
+char *NEO6_GetDateTime(struct NEO6 *gps, char *date_time, uint8_t size)
 {
-	static char date_time[32];
-	if (gps->info.quality)
-		sprintf(date_time, "%s %s UTC", gps->info.date, gps->info.utc_time);
+	struct NEO6_DateTime dt;
+
+	if (!size)
+		return date_time;
+
+	date_time[0] = '\0';
+	if (gps->info.quality) {
+		NEO6_SplitTime(gps->info.utc_time, &dt);
+
+		// date is not known yet
+		if (gps->info.utc_time < 86400)
+			dt.day = dt.month = dt.year = 0;
+
+		snprintf(date_time, size, "%02u.%02u.%04u %02u:%02u:%02u UTC", 
+			dt.day, dt.month, dt.year, dt.hour, dt.minute, dt.second);
+	}
 	
 	return date_time;
 
@@ -418,13 +2079,226 @@ double NEO6_GetAltitude(struct NEO6 *gps)
 {
 	double alt;
 	if (gps->info.quality)
-		alt = gps->info.pos.alt;
+		alt = NEO6_AltToMeters(gps->info.pos.alt);
 	else 
 		alt = -1;
 
 	return alt;
 }
 
+/**
+ * @brief Convert fixed-point latitude/longtitude to degrees and fractions of degrees
+ * 
+ * @param coord: latitude or longtitude in 1e-7 degrees (e.g. gps->info.pos.lat)
+ * 
+ * @retval (double) value in degrees
+*/
+double NEO6_CoordToDegrees(int32_t coord)
+{
+	return (double)coord / GPS_COORD_SCALE;
+}
+
+/**
+ * @brief Convert fixed-point altitude to metres
+ * 
+ * @param alt: altitude in millimetres (e.g. gps->info.pos.alt)
+ * 
+ * @retval (double) altitude in metres
+*/
+double NEO6_AltToMeters(int32_t alt)
+{
+	return (double)alt / GPS_ALT_SCALE;
+}
+
+/**
+ * @brief Convert calendar date and time (UTC) to seconds since 1970-01-01 00:00:00
+ * 
+ * @param dt: Pointer to date and time, year >= 1970
+ * 
+ * @retval (uint32_t) seconds since 1970-01-01
+*/
+uint32_t NEO6_MakeTime(const struct NEO6_DateTime *dt)
+{
+	// days from civil date; March based year puts leap day at the end
+	uint32_t year = dt->year - (dt->month <= 2);
+	uint32_t era = year / 400;
+	uint32_t yoe = year - era * 400;
+	uint32_t doy = (153 * (dt->month > 2 ? dt->month - 3 : dt->month + 9) + 2) / 5 + dt->day - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	uint32_t days = era * 146097 + doe - 719468;
+
+	return days * 86400 + dt->hour * 3600 + dt->minute * 60 + dt->second;
+}
+
+/**
+ * @brief Split seconds since 1970-01-01 00:00:00 to calendar date and time (UTC)
+ * 
+ * @param utc_time: seconds since 1970-01-01 (e.g. gps->info.utc_time)
+ * @param dt: Pointer to struct to store date and time
+ * 
+ * @retval void
+*/
+void NEO6_SplitTime(uint32_t utc_time, struct NEO6_DateTime *dt)
+{
+	uint32_t days = utc_time / 86400 + 719468;
+	uint32_t seconds = utc_time % 86400;
+	uint32_t era = days / 146097;
+	uint32_t doe = days - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+
+	dt->day = doy - (153 * mp + 2) / 5 + 1;
+	dt->month = (mp < 10) ? mp + 3 : mp - 9;
+	dt->year = yoe + era * 400 + (dt->month <= 2);
+
+	dt->hour = seconds / 3600;
+	dt->minute = (seconds / 60) % 60;
+	dt->second = seconds % 60;
+}
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Initialize gps struct with default values
+ * 
+ * @retval void
+*/
+void neo6_struct_init(struct NEO6 *gps, UART_HandleTypeDef *uart_handler, uint8_t rx_mode)
+{
+        gps->com.uart = uart_handler;
+        gps->com.rx_char = 0;
+        gps->com.rx_mode = rx_mode;
+        gps->com.dma_tail = 0;
+        gps->com.dma_head = 0;
+        gps->com.dma_restarts = 0;
+        gps->com.dma_restarts_seen = 0;
+        gps->com.parse_mode = GPS_PARSE_IN_ISR;
+        gps->com.ring.head = 0;
+        gps->com.ring.tail = 0;
+#ifdef GPS_USE_FREERTOS
+        gps->com.parser_task = NULL;
+#endif
+        gps->com.protocol = GPS_PROTOCOL_NMEA;
+        gps->com.ack_state = GPS_ACK_NONE;
+        gps->com.warm = NULL;
+        gps->com.warm_received = 0;
+        NMEA_ParserReset(&gps->parser);
+        UBX_ParserReset(&gps->ubx);
+        UBX_EpochReset(&gps->ubx);
+
+        gps->stats.accepted = 0;
+        gps->stats.rejected = 0;
+        gps->stats.overflowed = 0;
+        gps->stats.dropped = 0;
+        gps->stats.bytes = 0;
+        gps->stats.uart_errors = 0;
+        gps->stats.cycles_min = UINT32_MAX;
+        gps->stats.cycles_max = 0;
+        gps->stats.cycles_total = 0;
+        gps->stats.rate_bytes = 0;
+        gps->stats.rate_accepted = 0;
+        gps->stats.rate_tick = HAL_GetTick();
+
+#ifdef GPS_USE_DWT
+        // cycle counter runs only with trace enabled
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+        gps->fix_tick = 0;
+        gps->seq = 0;
+
+        NEO6_FilterInit(&gps->filter, GPS_FILTER_DEFAULT_WINDOW);
+        NEO6_PredictInit(&gps->predict);
+
+        NMEA_Subscribe(&gps->parser, GPS_FIELD_ALL);
+        memset(&gps->sats, 0, sizeof(gps->sats));
+
+	gps->info.quality = 0;
+        
+        gps->info.pos.lat = 0;
+        gps->info.pos.lat_dir = '0';
+
+        gps->info.pos.lon = 0;
+        gps->info.pos.lon_dir = '0';
+        
+        gps->info.pos.alt = 0;
+
+        gps->info.satellites = 0;
+        gps->info.hdop = 0;
+        gps->info.pdop = 0;
+        gps->info.vdop = 0;
+
+        gps->info.speed = 0;
+        gps->info.course = 0;
+        
+	gps->info.utc_time = 0;
+	gps->info.utc_ms = 0;
+}
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Register gps struct, so it can be found by its UART handle in HAL callbacks
+ * 
+ * @retval Status Code (GPS_BUF_FULL if GPS_MAX_INSTANCES structs are registered)
+*/
+uint8_t neo6_register(struct NEO6 *gps)
+{
+	uint8_t free_slot = GPS_MAX_INSTANCES;
+
+	for (uint8_t i = 0; i < GPS_MAX_INSTANCES; i++) {
+		// same struct or new struct for the same UART replaces the old one
+		if (neo6_instances[i] == gps || 
+		    (neo6_instances[i] != NULL && neo6_instances[i]->com.uart == gps->com.uart)) {
+			neo6_instances[i] = gps;
+			return GPS_OK;
+		}
+
+		if (neo6_instances[i] == NULL && free_slot == GPS_MAX_INSTANCES)
+			free_slot = i;
+	}
+
+	if (free_slot == GPS_MAX_INSTANCES)
+		return GPS_BUF_FULL;
+
+	neo6_instances[free_slot] = gps;
+	return GPS_OK;
+}
+
+#ifdef GPS_WARM_START
+#ifdef GPS_WARM_UTC_NOW
+// provided by application, see neo6.h
+uint32_t GPS_WARM_UTC_NOW(void);
+#endif
+
+/**
+ * INTERNAL FUNCTION
+ * 
+ * @brief Send warm start data stored in flash (if valid) to the module; 
+ * 	  ephemerides only with time from GPS_WARM_UTC_NOW (see NEO6_WarmRestore)
+ * 
+ * @param gps: Pointer to GPS configuration and received-information struct
+ * 
+ * @retval void
+*/
+void neo6_warm_boot(struct NEO6 *gps)
+{
+	// flash is memory mapped; no copy to RAM
+	const struct NEO6_WarmData *stored = (const struct NEO6_WarmData *)GPS_WARM_FLASH_ADDR;
+
+#ifdef GPS_WARM_UTC_NOW
+	uint32_t utc_now = GPS_WARM_UTC_NOW();
+#else
+	uint32_t utc_now = 0;
+#endif
+
+	if (NEO6_WarmValid(stored) == GPS_OK)
+		NEO6_WarmRestore(gps, stored, utc_now);
+}
+#endif
+
 /**
  * @brief Main User function; recevies, parses and stores useful data as: location, time, date, altitude
  * 
@@ -445,27 +2319,83 @@ uint8_t NEO6_Init(struct NEO6 *gps, UART_HandleTypeDef *uart_handler)
         /**
          * Initialize gps struct
         */
-        gps->com.uart = uart_handler;
-        gps->com.buffer_tail = 0;
-        gps->com.message_tail = 0;
-
-	gps->info.quality = 0;
-        
-        gps->info.pos.lat = 0;
-        gps->info.pos.lat_dir = '0';
-
-        gps->info.pos.lon = 0;
-        gps->info.pos.lon_dir = '0';
-        
-        gps->info.pos.alt = 0;
-        
-	sprintf(gps->info.utc_time, "00:00:00");
-	sprintf(gps->info.date, "00.00.0000");
+        neo6_struct_init(gps, uart_handler, GPS_RX_MODE_IT);
+        if (neo6_register(gps) != GPS_OK)
+                return GPS_BUF_FULL;
 
         /**
-         * Begin reception of data 
+         * Begin reception of data (without parsing the not yet received rx_char)
         */
-       return NEO6_UART_ReceiveChar(gps);
+        uint8_t result = neo6_start_reception(gps);
+
+#ifdef GPS_WARM_START
+        neo6_warm_boot(gps);
+#endif
+
+        return result;
+}
+
+
+/**
+ * @brief Same as NEO6_Init(...), but chars are received with circular DMA
+ * 	  and parsed in blocks on half transfer, transfer complete and idle line events
+ * 
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param uart_handler: Pointer to a UART_HandleTypeDef structure that contains
+ *                      the configuration information for the specified UART module
+ * 
+ * @note UART Rx DMA channel must be configured in circular mode,
+ * 	 NEO6_UART_RxEvent(...) must be called from HAL_UARTEx_RxEventCallback(...)
+ * 	 and NEO6_UART_ErrorCallback(...) from HAL_UART_ErrorCallback(...)
+ * 
+ * @retval Status Code
+*/
+uint8_t NEO6_InitDMA(struct NEO6 *gps, UART_HandleTypeDef *uart_handler)
+{
+        if (gps == NULL || uart_handler == NULL)
+                return GPS_ERR_NULL_PTR;
+
+        neo6_struct_init(gps, uart_handler, GPS_RX_MODE_DMA);
+        if (neo6_register(gps) != GPS_OK)
+                return GPS_BUF_FULL;
+
+        uint8_t result = HAL_UARTEx_ReceiveToIdle_DMA(uart_handler, gps->com.dma_buffer, GPS_DMA_BUFFER_SIZE);
+
+#ifdef GPS_WARM_START
+        if (result == HAL_OK)
+                neo6_warm_boot(gps);
+#endif
+
+        return result;
 }
 
 
+
+
+/**
+ * @brief Same as NEO6_Init(...), but without UART; chars are passed by the user 
+ * 	  with NEO6_ReceiveBuffer(...) (e.g. replay of recorded NMEA/UBX log)
+ * 
+ * Whole parsing path (sentences, filter, prediction, NEO6_GetFix(...)) works 
+ *  the same as with UART, so the library can also be built off-target; 
+ *  main.h must then provide UART_HandleTypeDef, HAL_UART_* and HAL_UARTEx_* 
+ *  functions used by neo6.c, HAL_GetTick(), HAL_Delay(), __DMB(), __get_PRIMASK(),
+ *  __set_PRIMASK() and __disable_irq()
+ * 
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * 
+ * @note NEO6_Configure(...) returns HAL_ERROR; select protocol of the log 
+ * 	 with NEO6_SetProtocol(...)
+ * 
+ * @retval Status Code
+*/
+uint8_t NEO6_InitReplay(struct NEO6 *gps)
+{
+        if (gps == NULL)
+                return GPS_ERR_NULL_PTR;
+
+        // not registered; there are no UART callbacks to dispatch
+        neo6_struct_init(gps, NULL, GPS_RX_MODE_NONE);
+
+        return GPS_OK;
+}
@@ -1,8 +1,65 @@
 #ifndef _NEO6_H
 #define _NEO6_H
 
+// Define GPS_USE_FREERTOS (e.g. in compiler flags) to wake parsing task with task notifications
+#ifdef GPS_USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+// Define GPS_USE_DWT to measure cycles spent storing parsed messages with the DWT cycle counter (Cortex-M3)
+
 #define GPS_MESSAGE_SIZE 90 // Maximum possible size of NMEA message
-#define GPS_BUFFER_SIZE 7 // Maximum number of messages to receive (< 256)
+#define GPS_FIELD_SIZE 16 // Maximum size of single NMEA field (incl. terminator)
+#define GPS_DMA_BUFFER_SIZE 256 // Size of circular DMA reception buffer
+#define GPS_RING_SIZE 128 // Size of ISR to task char ring (power of 2)
+#define GPS_MAX_INSTANCES 2 // Maximum number of NEO6 structs dispatched by UART handle
+#define GPS_LOCATION_SIZE 34 // Size of buffer for NEO6_GetLocation(...) (any int32_t coordinates)
+#define GPS_DATETIME_SIZE 32 // Size of buffer for NEO6_GetDateTime(...)
+#define GPS_HEALTH_SIZE 64 // Size of buffer for NEO6_HealthToString(...)
+#define GPS_SATS_SIZE 24 // Size of buffer for NEO6_SatSummaryToString(...)
+#define GPS_MAX_SATS 16 // Satellites kept in the table (more in view are counted only)
+#define GPS_GSV_SATS 4 // Satellites in single GSV sentence
+#define GPS_SNAPSHOT_RETRIES 8 // Attempts of NEO6_GetFix(...) to read info not being updated
+#define UBX_PAYLOAD_SIZE 104 // Maximum size of received UBX payload (AID-EPH with ephemeris)
+#define UBX_FRAME_OVERHEAD 8 // sync chars, class, id, length and checksum of UBX frame
+#define GPS_ACK_TIMEOUT 1000 // ms to wait for UBX-ACK of configuration message
+#define GPS_TX_TIMEOUT 100 // ms to wait for transmission of configuration message
+
+// Fixed-point scales of position data
+#define GPS_COORD_SCALE 10000000L // latitude/longtitude unit is 1e-7 degrees
+#define GPS_ALT_SCALE 1000L // altitude unit is millimetres
+#define GPS_DOP_SCALE 100 // DOP unit is 0.01
+#define GPS_COORD_PER_METER 90 // ~1e-7 degrees of latitude per metre
+#define GPS_EARTH_RADIUS_MM 6371000000LL // mean radius of the Earth in mm
+
+// Position filter (averaging of consecutive fixes)
+#define GPS_FILTER_MAX_WINDOW 16 // Maximum number of averaged fixes
+#define GPS_FILTER_DEFAULT_WINDOW 4 // Number of averaged fixes after NEO6_Init
+#define GPS_FILTER_GATE_M 25 // horizontal outlier gate in metres at HDOP 1.0 (twice for altitude)
+#define GPS_FILTER_MAX_REJECTS 3 // consecutive outliers after which the filter restarts
+
+// Position prediction between fixes
+#define GPS_PREDICT_MAX_MS 3000 // longest extrapolation after the fix (and age of usable barometric rate)
+#define GPS_PREDICT_BARO_MIN_MS 100 // shortest interval of barometric samples used for vertical rate
+#define GPS_PREDICT_MIN_COS 1144 // cos(latitude) limit in Q15 (~88 degrees) for longtitude rate
+
+// Warm start (last fix, time and ephemeris kept in flash), see NEO6_WarmCollect(...)
+// Define GPS_WARM_START to send stored data to the module from NEO6_Init(...) / NEO6_InitDMA(...),
+//  and GPS_WARM_UTC_NOW as name of uint32_t function(void) returning UTC seconds since 1970-01-01
+//  (e.g. from RTC with backup battery) to send ephemerides as well; without time only the position is sent
+#define GPS_WARM_MAX_EPH 8 // Number of stored ephemerides (fits 1 kB flash page)
+#define GPS_WARM_MAX_AGE 14400 // seconds after which stored ephemerides are not sent (~4 hours validity)
+#define GPS_WARM_POS_ACC_M 10000 // accuracy of the stored position sent to the module (receiver may have moved)
+#define GPS_WARM_TIME_ACC_MS 2000 // accuracy of time given to NEO6_WarmRestore(...)
+#define GPS_WARM_MAGIC 0x4E454F36UL // "NEO6"
+#define GPS_AID_TIMEOUT 1000 // ms to wait for all AID-EPH responses of the poll
+#define GPS_LEAP_SECONDS 18 // GPS - UTC time difference
+// The page is erased by NEO6_WarmSave(...), so it must be kept out of the program in the linker script,
+//  e.g. for STM32F103C8: FLASH (rx) : ORIGIN = 0x8000000, LENGTH = 63K
+#ifndef GPS_WARM_FLASH_ADDR
+#define GPS_WARM_FLASH_ADDR 0x0800FC00UL // last 1 kB page of 64 kB flash (STM32F103C8)
+#endif
 
 // Status Codes
 //   HAL_OK       = 0x00U,
@@ -15,6 +72,97 @@
 #define GPS_MSG_CPLT 0x07U
 #define GPS_CHR_RECEIVED 0x08U
 #define GPS_MESSAGE_INVALID 0x09U
+#define GPS_CFG_NAK 0x0AU
+
+// UART reception modes
+#define GPS_RX_MODE_IT 0x00U // one interrupt per received char
+#define GPS_RX_MODE_DMA 0x01U // circular DMA with idle-line detection
+#define GPS_RX_MODE_NONE 0x02U // no UART; chars are fed with NEO6_ReceiveBuffer(...), see NEO6_InitReplay(...)
+
+// Context of parsing received chars
+#define GPS_PARSE_IN_ISR 0x00U // chars are parsed in UART interrupt
+#define GPS_PARSE_IN_TASK 0x01U // interrupt only stores chars, NEO6_Process(...) parses them
+
+// Protocols of messages sent by the module
+#define GPS_PROTOCOL_NMEA 0x00U // NMEA 0183 text sentences (default output of the module)
+#define GPS_PROTOCOL_UBX 0x01U // u-blox binary frames (NAV-POSLLH, NAV-SOL, NAV-VELNED, NAV-TIMEUTC)
+
+// States of acknowledgement of the last configuration message
+#define GPS_ACK_NONE 0x00U // no configuration message is waiting for acknowledgement
+#define GPS_ACK_PENDING 0x01U
+#define GPS_ACK_RECEIVED 0x02U // UBX-ACK-ACK
+#define GPS_NAK_RECEIVED 0x03U // UBX-ACK-NAK
+
+// NMEA sentence types recognized by the parser (talkers GP, GN, GL and GA)
+#define NMEA_SENTENCE_UNKNOWN 0x00U
+#define NMEA_SENTENCE_GGA 0x01U
+#define NMEA_SENTENCE_RMC 0x02U
+#define NMEA_SENTENCE_VTG 0x03U
+#define NMEA_SENTENCE_GSA 0x04U
+#define NMEA_SENTENCE_GSV 0x05U // only with satellite table enabled, see NEO6_SatTableEnable(...)
+#define NMEA_SENTENCE_TYPES 6 // Number of NMEA_SENTENCE_* values
+
+// Groups of NMEA fields converted by the parser, see NEO6_Subscribe(...)
+#define GPS_FIELD_POSITION 0x0001U // latitude, longtitude
+#define GPS_FIELD_ALTITUDE 0x0002U
+#define GPS_FIELD_TIME 0x0004U // time and date
+#define GPS_FIELD_SPEED 0x0008U // speed and course over ground
+#define GPS_FIELD_DOP 0x0010U // DOP and number of satellites
+#define GPS_FIELD_SATS 0x0020U // satellite table (GSV, used PRNs of GSA), see NEO6_SatTableEnable(...)
+#define GPS_FIELD_ALL 0x001FU // all except satellite table (default)
+#define GPS_FIELD_REQUIRED 0x8000U // quality of fix; always converted
+
+// NMEA parser states
+#define NMEA_STATE_IDLE 0x00U // waiting for '$'
+#define NMEA_STATE_FIELDS 0x01U // receiving comma separated fields
+#define NMEA_STATE_CHECKSUM 0x02U // '*' received, receiving checksum digits
+
+// UBX frame sync chars, message classes and ids
+#define UBX_SYNC_CHAR_1 0xB5U
+#define UBX_SYNC_CHAR_2 0x62U
+#define UBX_CLASS_NAV 0x01U
+#define UBX_NAV_POSLLH 0x02U
+#define UBX_NAV_SOL 0x06U
+#define UBX_NAV_VELNED 0x12U
+#define UBX_NAV_TIMEUTC 0x21U
+#define UBX_CLASS_ACK 0x05U
+#define UBX_ACK_NAK 0x00U
+#define UBX_ACK_ACK 0x01U
+#define UBX_CLASS_CFG 0x06U
+#define UBX_CFG_PRT 0x00U
+#define UBX_CFG_MSG 0x01U
+#define UBX_CFG_RATE 0x08U
+#define UBX_CLASS_AID 0x0BU
+#define UBX_AID_INI 0x01U
+#define UBX_AID_EPH 0x31U
+#define UBX_AID_EPH_SIZE 104 // AID-EPH payload of a satellite with ephemeris (8 bytes without)
+#define UBX_AID_EPH_COUNT 32 // AID-EPH poll is answered for each GPS satellite
+
+// NMEA standard messages (class and ids used in UBX-CFG-MSG)
+#define UBX_CLASS_NMEA 0xF0U
+#define UBX_NMEA_GGA 0x00U
+#define UBX_NMEA_GLL 0x01U
+#define UBX_NMEA_GSA 0x02U
+#define UBX_NMEA_GSV 0x03U
+#define UBX_NMEA_RMC 0x04U
+#define UBX_NMEA_VTG 0x05U
+
+// UBX parser states
+#define UBX_STATE_SYNC_1 0x00U
+#define UBX_STATE_SYNC_2 0x01U
+#define UBX_STATE_CLASS 0x02U
+#define UBX_STATE_ID 0x03U
+#define UBX_STATE_LENGTH_1 0x04U
+#define UBX_STATE_LENGTH_2 0x05U
+#define UBX_STATE_PAYLOAD 0x06U
+#define UBX_STATE_CK_A 0x07U
+#define UBX_STATE_CK_B 0x08U
+
+// NAV messages received in the UBX navigation epoch (UBX_Parser epoch_parts)
+#define UBX_EPOCH_POSLLH 0x01U
+#define UBX_EPOCH_SOL 0x02U
+#define UBX_EPOCH_STORED 0x04U // position of the epoch is stored (or dropped without fix)
+#define UBX_EPOCH_VELNED 0x08U
 
 // ****************************************************
 //          Data Structures                           *
@@ -26,18 +174,18 @@
 */
 struct position_data
 {
-        // latitude of location in degrees and fractions of degrees (18.1231)
-        double lat;
+        // latitude of location in 1e-7 degrees (18.1231 deg = 181231000)
+        int32_t lat;
         // direction of latitude value e.g. N or S
         char lat_dir;
 
-        // longtitude of location in degrees and fractions of degrees
-        double lon;
+        // longtitude of location in 1e-7 degrees
+        int32_t lon;
         // direction of longtitude value e.g. E or W
         char lon_dir;
 
-        // altitude of the object
-        double alt;
+        // altitude of the object in millimetres (above mean sea level)
+        int32_t alt;
 };
 
 /**
@@ -57,18 +205,18 @@ struct NEO6_ParsedInfo
         struct position_data pos;
 
         /**
-         * UTC time of FIX
+         * UTC date and time of FIX in seconds since 1970-01-01 00:00:00
          * 
-         * Format: hh:mm:ss (UTC)
+         * Less than 86400 (one day) if only time is known (no date received yet)
+         * see NEO6_SplitTime(...) and NEO6_GetDateTime(...) for formatting
         */
-        char utc_time[14];
+        uint32_t utc_time;
 
         /**
-         * Date of FIX
-         *
-         * Format: dd.mm.yyyy 
+         * Milliseconds of UTC time of FIX
+         * 
         */
-        char date[14];
+        uint16_t utc_ms;
 
         /**
          * Quality of fix
@@ -76,6 +224,74 @@ struct NEO6_ParsedInfo
          * 0 = Invalid, 1 = GPS fix, 2 = DGPS fix, 3 = PPS fix, 4 = Real Time Kinematic, etc.
         */
         uint8_t quality;
+
+        /**
+         * Number of satellites used in fix
+         * 
+        */
+        uint8_t satellites;
+
+        /**
+         * Horizontal dilution of precision in 0.01 units (0 = unknown)
+         * 
+         * UBX: position DOP of NAV-SOL, as NEO-6 reports no HDOP in it
+        */
+        uint16_t hdop;
+
+        /**
+         * Position and vertical dilution of precision in 0.01 units (0 = unknown)
+         * 
+        */
+        uint16_t pdop;
+        uint16_t vdop;
+
+        /**
+         * Speed over ground in cm/s
+         * 
+        */
+        uint16_t speed;
+
+        /**
+         * Course over ground (true) in 0.01 degrees
+         * 
+        */
+        uint16_t course;
+};
+
+/**
+ * Single producer (UART interrupt), single consumer (parsing task) char ring
+ * 
+ * head is written only by the producer and tail only by the consumer,
+ *  so no locking is needed; one slot is kept empty to tell full from empty
+ * 
+*/
+struct NEO6_Ring {
+        uint8_t data[GPS_RING_SIZE];
+
+        /**
+         * Index of next free slot (producer)
+         * 
+        */
+        volatile uint16_t head;
+
+        /**
+         * Index of next char to parse (consumer)
+         * 
+        */
+        volatile uint16_t tail;
+};
+
+/**
+ * UTC date and time split into calendar fields
+ * 
+*/
+struct NEO6_DateTime {
+        uint16_t year;
+        uint8_t month; // 1 .. 12
+        uint8_t day; // 1 .. 31
+        uint8_t hour;
+        uint8_t minute;
+        uint8_t second;
 };
 
 /**
@@ -90,25 +306,645 @@ struct NEO6_ComConf {
         UART_HandleTypeDef *uart;
 
         /**
-         * Message buffer to temporarily hold some amount of 
-         *  received NMEA messages before parsing
+         * Char received by HAL_UART_Receive_IT(...) (GPS_RX_MODE_IT)
+         * 
+        */
+        uint8_t rx_char;
+
+        /**
+         * Protocol of the received messages (GPS_PROTOCOL_*)
+         * 
+        */
+        uint8_t protocol;
+
+        /**
+         * UART reception mode (GPS_RX_MODE_*)
+         * 
+        */
+        uint8_t rx_mode;
+
+        /**
+         * Circular buffer filled by DMA in GPS_RX_MODE_DMA
+         * 
+        */
+        uint8_t dma_buffer[GPS_DMA_BUFFER_SIZE];
+
+        /**
+         * Index of the first char in dma_buffer which is not parsed yet
+         * 
+        */
+        uint16_t dma_tail;
+
+        /**
+         * Position of DMA in dma_buffer at the last reception event (GPS_PARSE_IN_TASK)
+         * 
+        */
+        volatile uint16_t dma_head;
+
+        /**
+         * Incremented by NEO6_UART_Error(...) when DMA starts again at the beginning of dma_buffer
+         *  (GPS_PARSE_IN_TASK); NEO6_Process(...) then drops the rest of the previous lap and 
+         *  the interrupted message, and counts it in dma_restarts_seen
+         * 
+        */
+        volatile uint8_t dma_restarts;
+        uint8_t dma_restarts_seen;
+
+        /**
+         * Context of parsing (GPS_PARSE_*)
+         * 
+        */
+        uint8_t parse_mode;
+
+        /**
+         * Chars received in interrupt, waiting for the parsing task (GPS_RX_MODE_IT)
+         * 
+        */
+        struct NEO6_Ring ring;
+
+#ifdef GPS_USE_FREERTOS
+        /**
+         * Task notified when new chars are received (GPS_PARSE_IN_TASK), may be NULL
+         * 
+        */
+        TaskHandle_t parser_task;
+#endif
+
+        /**
+         * Class and id of the configuration message waiting for acknowledgement
+         * 
+        */
+        uint8_t ack_class;
+        uint8_t ack_id;
+
+        /**
+         * Acknowledgement state (GPS_ACK_*), updated from UART interrupt
+         * 
+        */
+        volatile uint8_t ack_state;
+
+        /**
+         * Warm start data collecting AID-EPH responses (see NEO6_WarmCollect), NULL otherwise
+         * 
+        */
+        struct NEO6_WarmData *volatile warm;
+        volatile uint8_t warm_received;
+};
+
+/**
+ * Receiver configuration sent by NEO6_Configure(...)
+ * 
+*/
+struct NEO6_Config {
+        /**
+         * Protocol of output messages (GPS_PROTOCOL_*)
+         * 
+         * NMEA: only GPGGA and GPRMC are enabled, GPGSA with GPS_FIELD_DOP or GPS_FIELD_SATS 
+         *  subscribed and GPGSV with GPS_FIELD_SATS (see NEO6_Subscribe(...))
+         * UBX: only NAV-POSLLH, NAV-SOL, NAV-VELNED and NAV-TIMEUTC are enabled
+        */
+        uint8_t protocol;
+
+        /**
+         * Navigation (measurement) period in ms; 200 (5 Hz) is the minimum for NEO-6
+         * 
+        */
+        uint16_t rate_ms;
+
+        /**
+         * New UART baudrate (e.g. 115200); 0 keeps the current one
+         * 
+        */
+        uint32_t baudrate;
+};
+
+/**
+ * Satellite in view (GSV), see struct NEO6_SatTable
+ * 
+*/
+struct NEO6_Satellite {
+        uint8_t prn;
+        uint8_t elevation; // degrees
+        uint16_t azimuth; // degrees
+        uint8_t snr; // dB-Hz, 0 if not tracked
+        uint8_t used; // 1 if used in fix (GSA)
+};
+
+/**
+ * State of the streaming NMEA parser
+ * 
+ * Sentence is parsed field by field while characters arrive,
+ *  so only the field being received is buffered
+ * 
+*/
+struct NMEA_Parser {
+        /**
+         * Information parsed from the sentence being received
+         * 
+        */
+        struct NEO6_ParsedInfo info;
+
+        /**
+         * Time of day of the sentence in ms since midnight (UINT32_MAX if not received)
+         * 
+        */
+        uint32_t time_of_day;
+
+        /**
+         * Date of the sentence in days since 1970-01-01 (0 if not received)
+         * 
+        */
+        uint16_t date;
+
+        /**
+         * Characters of the field being received
+         * 
+        */
+        char field[GPS_FIELD_SIZE];
+
+        /**
+         * Number of chars in field buffer
+         * 
+        */
+        uint8_t field_len;
+
+        /**
+         * Index of the field being received (0 = address field, e.g. GPGGA)
+         * 
+        */
+        uint8_t field_idx;
+
+        /**
+         * Type of the sentence being received (NMEA_SENTENCE_*)
+         * 
+        */
+        uint8_t sentence;
+
+        /**
+         * Last four chars of the address field, packed while they arrive
+         * 
+         * e.g. "GPGGA" -> 'P' << 24 | 'G' << 16 | 'G' << 8 | 'A'
+        */
+        uint32_t address;
+
+        /**
+         * Current state of the parser (NMEA_STATE_*)
+         * 
+        */
+        uint8_t state;
+
+        /**
+         * Number of chars received since '$'
+         * 
+        */
+        uint8_t length;
+
+        /**
+         * XOR of all chars between '$' and '*'
+         * 
+        */
+        uint8_t checksum;
+
+        /**
+         * Checksum received after '*' (two hex digits)
+         * 
+        */
+        uint8_t received_checksum;
+
+        /**
+         * Number of received checksum digits
+         * 
+        */
+        uint8_t checksum_digits;
+
+        /**
+         * Satellites of the GSV sentence being received and its part number, 
+         *  number of parts and satellites in view
+         * 
+        */
+        struct NEO6_Satellite gsv[GPS_GSV_SATS];
+        uint8_t gsv_count;
+        uint8_t gsv_part;
+        uint8_t gsv_parts;
+        uint8_t gsv_in_view;
+
+        /**
+         * Bit mask of PRNs 1 .. 96 used in fix (GSA sentence being received)
          * 
-         * Mainly used to find average location
+        */
+        uint32_t gsa_used[3];
+
+        /**
+         * Subscribed field groups (GPS_FIELD_*) and resulting bit mask of converted 
+         *  fields for each sentence type (bit n = field n); kept by NMEA_ParserReset
          * 
         */
-        char messages_buffer[(uint8_t)GPS_BUFFER_SIZE][(uint8_t)GPS_MESSAGE_SIZE];
+        uint16_t subscribed;
+        uint32_t field_mask[NMEA_SENTENCE_TYPES];
 
         /**
-        * Buffer tail is indicating the index of next free part of message_buffer
-        * -1 if message_buffer is full 
+         * Field mask and groups of the sentence being received, taken from the above 
+         *  after its address field, so that a change of subscription applies to whole sentences
+         * 
         */
-        int8_t buffer_tail; 
+        uint32_t sentence_fields;
+        uint16_t sentence_groups;
+};
 
+/**
+ * Warm start data kept in flash page at GPS_WARM_FLASH_ADDR
+ * 
+ * Position is signed (negative for S and W), eph holds AID-EPH payloads
+ * 
+*/
+struct NEO6_WarmData {
         /**
-         * Message tail is indicating the index of next free place to save received char
+         * GPS_WARM_MAGIC if the page holds warm start data
          * 
         */
-       int8_t message_tail;
+        uint32_t magic;
+
+        /**
+         * UTC time of the fix in seconds since 1970-01-01 and its position (1e-7 degrees, mm)
+         * 
+        */
+        uint32_t utc_time;
+        int32_t lat;
+        int32_t lon;
+        int32_t alt;
+
+        /**
+         * Number of stored ephemerides
+         * 
+        */
+        uint8_t eph_count;
+        uint8_t reserved[3];
+        uint8_t eph[GPS_WARM_MAX_EPH][UBX_AID_EPH_SIZE];
+
+        /**
+         * CRC-32 of all previous fields
+         * 
+        */
+        uint32_t crc;
+};
+
+/**
+ * State of the UBX binary frame parser
+ * 
+ * Frame: 0xB5 0x62 | class | id | length (2, little endian) | payload | CK_A CK_B
+ * 
+*/
+struct UBX_Parser {
+        /**
+         * Current state of the parser (UBX_STATE_*)
+         * 
+        */
+        uint8_t state;
+
+        /**
+         * Class and id of the frame being received
+         * 
+        */
+        uint8_t msg_class;
+        uint8_t msg_id;
+
+        /**
+         * Payload length of the frame and number of payload bytes received so far
+         * 
+        */
+        uint16_t length;
+        uint16_t index;
+
+        /**
+         * 8-bit Fletcher checksum of class, id, length and payload
+         * 
+        */
+        uint8_t ck_a;
+        uint8_t ck_b;
+
+        /**
+         * Payload of the frame being received
+         * 
+        */
+        uint8_t payload[UBX_PAYLOAD_SIZE];
+
+        /**
+         * Navigation epoch being received: GPS time of week (iTOW, ms), its NAV messages 
+         *  (UBX_EPOCH_*), signed NAV-POSLLH position (1e-7 degrees, mm) and NAV-VELNED 
+         *  speed (cm/s) and course (0.01 degrees) waiting for the rest of the same epoch; 
+         *  kept by UBX_ParserReset
+         * 
+        */
+        uint32_t epoch_itow;
+        uint8_t epoch_parts;
+        int32_t epoch_lat;
+        int32_t epoch_lon;
+        int32_t epoch_alt;
+        uint16_t epoch_speed;
+        uint16_t epoch_course;
+};
+
+/**
+ * Counters of received NMEA sentences
+ * 
+*/
+struct NEO6_Stats {
+        /**
+         * Sentences (or UBX frames) with valid checksum
+         * 
+        */
+        uint32_t accepted;
+
+        /**
+         * Sentences dropped because of wrong or missing checksum or invalid chars
+         * 
+        */
+        uint32_t rejected;
+
+        /**
+         * Sentences dropped because they did not fit GPS_MESSAGE_SIZE or GPS_FIELD_SIZE
+         * 
+        */
+        uint32_t overflowed;
+
+        /**
+         * Chars lost because the ring was full (parsing task was too slow)
+         * 
+        */
+        uint32_t dropped;
+
+        /**
+         * Received chars (or bytes of UBX frames) passed to the parser
+         * 
+        */
+        uint32_t bytes;
+
+        /**
+         * UART errors (overrun, noise, framing) reported by NEO6_UART_ErrorCallback(...)
+         * 
+        */
+        uint32_t uart_errors;
+
+        /**
+         * CPU cycles of storing completed messages (calc_info), GPS_USE_DWT only
+         * 
+        */
+        uint32_t cycles_min;
+        uint32_t cycles_max;
+        uint64_t cycles_total;
+
+        /**
+         * Totals and HAL tick at the previous NEO6_GetHealth(...), for rates
+         * 
+        */
+        uint32_t rate_bytes;
+        uint32_t rate_accepted;
+        uint32_t rate_tick;
+};
+
+/**
+ * Satellites in view, updated part by part from GSV sequence
+ * 
+*/
+struct NEO6_SatTable {
+        struct NEO6_Satellite sat[GPS_MAX_SATS];
+
+        /**
+         * Valid entries of sat and number of satellites in view (may be higher)
+         * 
+        */
+        uint8_t count;
+        uint8_t in_view;
+
+        /**
+         * Bit mask of PRNs 1 .. 96 used in fix (last GSA)
+         * 
+        */
+        uint32_t used[3];
+};
+
+/**
+ * Compact satellite summary for telemetry, see NEO6_SatSummary(...)
+ * 
+*/
+struct NEO6_SatSummary {
+        uint8_t in_view;
+        uint8_t tracked; // satellites with SNR
+        uint8_t used; // satellites used in fix
+        uint8_t snr_max; // of all tracked satellites
+        uint8_t snr_min_used; // of satellites used in fix
+        uint8_t snr_avg_used;
+};
+
+/**
+ * Health of the receive path for telemetry, see NEO6_GetHealth(...)
+ * 
+*/
+struct NEO6_Health {
+        /**
+         * Totals since initialization (see struct NEO6_Stats)
+         * 
+        */
+        uint32_t bytes;
+        uint32_t accepted;
+        uint32_t rejected;
+        uint32_t overflowed;
+        uint32_t dropped;
+        uint32_t uart_errors;
+
+        /**
+         * Rates since the previous NEO6_GetHealth(...)
+         * 
+        */
+        uint16_t bytes_per_s;
+        uint16_t messages_per_s;
+
+        /**
+         * CPU cycles of storing completed messages; 0 without GPS_USE_DWT
+         * 
+        */
+        uint32_t cycles_min;
+        uint32_t cycles_max;
+        uint32_t cycles_avg;
+
+        /**
+         * Outliers rejected by the position filter
+         * 
+        */
+        uint32_t outliers;
+
+        /**
+         * Time since the last valid position fix in ms (UINT32_MAX if there was none)
+         * 
+        */
+        uint32_t fix_age_ms;
+};
+
+/**
+ * Single fix in the window of position filter (signed values, S and W are negative)
+ * 
+*/
+struct NEO6_FilterSample {
+        int32_t lat;
+        int32_t lon;
+        int32_t alt;
+        uint16_t weight;
+};
+
+/**
+ * Weighted moving average of the last fixes with outlier rejection
+ * 
+ * Sums are updated incrementally, so each fix costs the same regardless of window
+ * 
+*/
+struct NEO6_Filter {
+        /**
+         * Ring of fixes in the window
+         * 
+        */
+        struct NEO6_FilterSample samples[GPS_FILTER_MAX_WINDOW];
+
+        /**
+         * Weighted sums of fixes in the window
+         * 
+        */
+        int64_t sum_lat;
+        int64_t sum_lon;
+        int64_t sum_alt;
+        uint32_t sum_weight;
+
+        /**
+         * Size of the window, number of fixes in it and index of the oldest one
+         * 
+        */
+        uint8_t window;
+        uint8_t count;
+        uint8_t oldest;
+
+        /**
+         * Number of consecutive rejected fixes
+         * 
+        */
+        uint8_t rejects_in_row;
+
+        /**
+         * Total number of rejected fixes
+         * 
+        */
+        uint32_t outliers;
+
+        /**
+         * Filtered position; valid if count > 0
+         * 
+        */
+        struct position_data pos;
+};
+
+/**
+ * Extrapolation of the last fix, see NEO6_Predict(...)
+ * 
+ * Position is signed (negative for S and W), rates are per second
+ * 
+*/
+struct NEO6_Predictor {
+        /**
+         * Position of the last fix (1e-7 degrees, mm) and its HAL tick
+         * 
+        */
+        int32_t lat;
+        int32_t lon;
+        int32_t alt;
+        uint32_t tick;
+
+        /**
+         * Ground velocity of the last fix in 1e-7 degrees per second
+         * 
+        */
+        int32_t v_lat;
+        int32_t v_lon;
+
+        /**
+         * Last used barometric altitude (mm), its HAL tick and smoothed vertical rate (mm/s)
+         * 
+        */
+        int32_t baro_alt;
+        uint32_t baro_tick;
+        int32_t v_alt;
+        uint8_t baro_valid;
+
+        /**
+         * Set after the first fix
+         * 
+        */
+        uint8_t valid;
+};
+
+/**
+ * Reference point of local coordinates, see NEO6_GeoSetRef(...)
+ * 
+*/
+struct NEO6_GeoRef {
+        /**
+         * Signed position (1e-7 degrees, mm)
+         * 
+        */
+        int32_t lat;
+        int32_t lon;
+        int32_t alt;
+
+        /**
+         * Length of 1e-7 degrees of latitude at the reference in mm, Q16
+         * 
+        */
+        int32_t lat_scale;
+
+        /**
+         * sin and cos of the reference latitude, Q15
+         * 
+        */
+        int32_t lat_sin;
+        int32_t lat_cos;
+};
+
+/**
+ * Local east-north-up offsets from the reference point in mm
+ * 
+*/
+struct NEO6_ENU {
+        int32_t east;
+        int32_t north;
+        int32_t up;
+};
+
+/**
+ * Consistent copy of the received information, see NEO6_GetFix(...)
+ * 
+*/
+struct NEO6_Fix {
+        /**
+         * Parsed information (position, time, quality, DOP, ...)
+         * 
+        */
+        struct NEO6_ParsedInfo info;
+
+        /**
+         * Filtered position (see struct NEO6_Filter), valid if filtered_count > 0
+         * 
+        */
+        struct position_data filtered;
+        uint8_t filtered_count;
+
+        /**
+         * Predictor state, for NEO6_Predict(&fix.predict, ...)
+         * 
+        */
+        struct NEO6_Predictor predict;
+
+        /**
+         * Time since the last valid position fix in ms (UINT32_MAX if there was none)
+         * 
+        */
+        uint32_t age_ms;
 };
 
 /**
@@ -118,6 +954,24 @@ struct NEO6_ComConf {
 struct NEO6 { 
         struct NEO6_ParsedInfo info;
         struct NEO6_ComConf com;
+        struct NMEA_Parser parser;
+        struct UBX_Parser ubx;
+        struct NEO6_Stats stats;
+        struct NEO6_Filter filter;
+        struct NEO6_Predictor predict;
+        struct NEO6_SatTable sats;
+
+        /**
+         * HAL tick of the last valid position fix
+         * 
+        */
+        uint32_t fix_tick;
+
+        /**
+         * Sequence counter of info and filter updates; odd while an update is in progress
+         * 
+        */
+        volatile uint32_t seq;
 
 };
 
@@ -128,13 +982,76 @@ struct NEO6 {
 // ****************************************************
 
 uint8_t NEO6_Init(struct NEO6 *gps, UART_HandleTypeDef *uart_handler);
+uint8_t NEO6_InitDMA(struct NEO6 *gps, UART_HandleTypeDef *uart_handler);
+uint8_t NEO6_InitReplay(struct NEO6 *gps);
 uint8_t NEO6_UART_ReceiveChar(struct NEO6 *gps);
+uint8_t NEO6_UART_RxEvent(struct NEO6 *gps, uint16_t size);
+uint8_t NEO6_UART_Error(struct NEO6 *gps);
+uint8_t NEO6_ReceiveBuffer(struct NEO6 *gps, const char *data, uint16_t len);
+uint8_t NEO6_SetProtocol(struct NEO6 *gps, uint8_t protocol);
+uint8_t NEO6_SetParseMode(struct NEO6 *gps, uint8_t parse_mode);
+uint8_t NEO6_Process(struct NEO6 *gps);
+#ifdef GPS_USE_FREERTOS
+void NEO6_Task(void *argument);
+#endif
+uint8_t NEO6_Configure(struct NEO6 *gps, const struct NEO6_Config *cfg);
+
+struct NEO6 *NEO6_FromUART(UART_HandleTypeDef *uart_handler);
+void NEO6_UART_RxCpltCallback(UART_HandleTypeDef *uart_handler);
+void NEO6_UART_RxEventCallback(UART_HandleTypeDef *uart_handler, uint16_t size);
+void NEO6_UART_ErrorCallback(UART_HandleTypeDef *uart_handler);
 
-char *NEO6_GetLocation(struct NEO6 *gps);
-char *NEO6_GetDateTime(struct NEO6 *gps);
+uint8_t NEO6_GetFix(struct NEO6 *gps, struct NEO6_Fix *fix);
+uint8_t NEO6_GetHealth(struct NEO6 *gps, struct NEO6_Health *health);
+char *NEO6_HealthToString(const struct NEO6_Health *health, char *text, uint8_t size);
+uint8_t NEO6_Subscribe(struct NEO6 *gps, uint16_t fields);
+uint8_t NEO6_Unsubscribe(struct NEO6 *gps, uint16_t fields);
+uint8_t NEO6_SatTableEnable(struct NEO6 *gps, uint8_t enable);
+uint8_t NEO6_GetSatellites(struct NEO6 *gps, struct NEO6_SatTable *table);
+void NEO6_SatSummary(const struct NEO6_SatTable *table, struct NEO6_SatSummary *summary);
+char *NEO6_SatSummaryToString(const struct NEO6_SatSummary *summary, char *text, uint8_t size);
+char *NEO6_GetLocation(struct NEO6 *gps, char *location, uint8_t size);
+char *NEO6_GetDateTime(struct NEO6 *gps, char *date_time, uint8_t size);
 double NEO6_GetAltitude(struct NEO6 *gps);
+double NEO6_CoordToDegrees(int32_t coord);
+double NEO6_AltToMeters(int32_t alt);
+uint32_t NEO6_MakeTime(const struct NEO6_DateTime *dt);
+void NEO6_SplitTime(uint32_t utc_time, struct NEO6_DateTime *dt);
 void NEO6_PrintInfo(struct NEO6 *gps);
 
 void NMEA_MessageParse(char *message, struct NEO6_ParsedInfo *info);
+void NMEA_ParserReset(struct NMEA_Parser *parser);
+uint8_t NMEA_ParseChar(struct NMEA_Parser *parser, char c);
+void NMEA_Subscribe(struct NMEA_Parser *parser, uint16_t fields);
+uint16_t NMEA_ParseRun(struct NMEA_Parser *parser, const char *data, uint16_t len);
+
+void UBX_ParserReset(struct UBX_Parser *parser);
+uint8_t UBX_ParseByte(struct UBX_Parser *parser, uint8_t byte);
+uint8_t UBX_MessageParse(struct UBX_Parser *parser, struct NEO6_ParsedInfo *info);
+void UBX_EpochReset(struct UBX_Parser *parser);
+uint8_t UBX_EpochStore(struct UBX_Parser *parser, struct NEO6_ParsedInfo *info);
+void NEO6_FilterInit(struct NEO6_Filter *filter, uint8_t window);
+uint8_t NEO6_FilterUpdate(struct NEO6_Filter *filter, const struct NEO6_ParsedInfo *info);
+void NEO6_PredictInit(struct NEO6_Predictor *pred);
+void NEO6_PredictUpdate(struct NEO6_Predictor *pred, const struct NEO6_ParsedInfo *info, uint32_t tick);
+void NEO6_PredictBaro(struct NEO6_Predictor *pred, int32_t alt, uint32_t tick);
+uint8_t NEO6_Predict(const struct NEO6_Predictor *pred, uint32_t tick, struct position_data *pos);
+int32_t NEO6_SinQ15(int32_t angle);
+
+void NEO6_GeoSigned(const struct position_data *pos, int32_t *lat, int32_t *lon);
+void NEO6_GeoSetRef(struct NEO6_GeoRef *ref, const struct position_data *pos);
+void NEO6_GeoToENU(const struct NEO6_GeoRef *ref, const struct position_data *pos, struct NEO6_ENU *enu);
+uint32_t NEO6_GeoDistance(const struct NEO6_ENU *enu);
+uint16_t NEO6_GeoBearing(const struct NEO6_ENU *enu);
+void NEO6_GeoDistanceBearing(const struct position_data *from, const struct position_data *to, uint32_t *distance, uint16_t *bearing);
+int32_t NEO6_Atan2(int32_t y, int32_t x);
+
+uint8_t NEO6_WarmCollect(struct NEO6 *gps, struct NEO6_WarmData *data);
+uint8_t NEO6_WarmSave(const struct NEO6_WarmData *data);
+uint8_t NEO6_WarmValid(const struct NEO6_WarmData *data);
+uint8_t NEO6_WarmRestore(struct NEO6 *gps, const struct NEO6_WarmData *data, uint32_t utc_now);
+int32_t NEO6_CosQ15(int32_t angle);
+
+uint16_t UBX_BuildFrame(uint8_t *frame, uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length);
 
 #endif
\ No newline at end of file
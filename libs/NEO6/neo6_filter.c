@@ -0,0 +1,181 @@
+#include <stdlib.h>
+#include "main.h"
+
+#include "neo6.h"
+
+
+/**  --------------------------- INTERNAL FUNCTIONS ---------------------------  **/
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Convert value and direction char to signed value (negative for S and W)
+ *
+*/
+int32_t filter_signed(int32_t value, char dir)
+{
+	return (dir == 'S' || dir == 'W') ? -value : value;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Weight of the fix; grows with number of satellites and falls with HDOP
+ *
+ * @retval (uint16_t) weight, at least 1
+*/
+uint16_t filter_weight(const struct NEO6_ParsedInfo *info)
+{
+	// unknown values are treated as a poor fix
+	uint32_t hdop = info->hdop ? info->hdop : 5 * GPS_DOP_SCALE;
+	uint32_t sats = info->satellites ? info->satellites : 4;
+	uint32_t weight = sats * 16 * GPS_DOP_SCALE / hdop;
+
+	if (weight < 1)
+		weight = 1;
+	else if (weight > UINT16_MAX)
+		weight = UINT16_MAX;
+
+	return (uint16_t)weight;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Recalculate filtered position from the weighted sums
+ *
+*/
+void filter_output(struct NEO6_Filter *filter)
+{
+	int32_t lat = (int32_t)(filter->sum_lat / (int64_t)filter->sum_weight);
+	int32_t lon = (int32_t)(filter->sum_lon / (int64_t)filter->sum_weight);
+
+	filter->pos.lat = labs(lat);
+	filter->pos.lat_dir = (lat < 0) ? 'S' : 'N';
+
+	filter->pos.lon = labs(lon);
+	filter->pos.lon_dir = (lon < 0) ? 'W' : 'E';
+
+	filter->pos.alt = (int32_t)(filter->sum_alt / (int64_t)filter->sum_weight);
+}
+
+
+/** --------------------------- LIBRARY FUNCTIONS --------------------------- **/
+
+/**
+ * @brief Clear position filter and set its window
+ *
+ * @param filter: Pointer to position filter (e.g. &gps->filter)
+ * @param window: number of averaged fixes (1 .. GPS_FILTER_MAX_WINDOW, 1 = only outlier rejection)
+ *
+ * @retval void
+*/
+void NEO6_FilterInit(struct NEO6_Filter *filter, uint8_t window)
+{
+	if (window < 1)
+		window = 1;
+	else if (window > GPS_FILTER_MAX_WINDOW)
+		window = GPS_FILTER_MAX_WINDOW;
+
+	filter->window = window;
+	filter->count = 0;
+	filter->oldest = 0;
+	filter->rejects_in_row = 0;
+	filter->outliers = 0;
+
+	filter->sum_lat = 0;
+	filter->sum_lon = 0;
+	filter->sum_alt = 0;
+	filter->sum_weight = 0;
+
+	filter->pos.lat = 0;
+	filter->pos.lat_dir = '0';
+	filter->pos.lon = 0;
+	filter->pos.lon_dir = '0';
+	filter->pos.alt = 0;
+}
+
+
+/**
+ * @brief Add new fix to the position filter; called by the driver for every epoch with valid fix
+ *
+ * Fix further than GPS_FILTER_GATE_M (scaled by its HDOP) from the filtered
+ *  position is rejected; after GPS_FILTER_MAX_REJECTS rejections in a row
+ *  the filter restarts from the new fix (position really changed)
+ *
+ * @param filter: Pointer to position filter
+ * @param info: Pointer to parsed info of the fix (position, HDOP, number of satellites)
+ *
+ * @retval Status Code
+ * 	GPS_OK - fix is averaged
+ * 	GPS_MESSAGE_INVALID - fix is rejected (outlier or no fix)
+*/
+uint8_t NEO6_FilterUpdate(struct NEO6_Filter *filter, const struct NEO6_ParsedInfo *info)
+{
+	struct NEO6_FilterSample sample;
+	uint8_t idx;
+
+	if (!info->quality)
+		return GPS_MESSAGE_INVALID;
+
+	sample.lat = filter_signed(info->pos.lat, info->pos.lat_dir);
+	sample.lon = filter_signed(info->pos.lon, info->pos.lon_dir);
+	sample.alt = info->pos.alt;
+	sample.weight = filter_weight(info);
+
+	if (filter->count) {
+		int32_t hdop = info->hdop ? info->hdop : 5 * GPS_DOP_SCALE;
+		// longtitude degrees are shorter than latitude ones, so its gate is looser in metres
+		int32_t gate = GPS_FILTER_GATE_M * GPS_COORD_PER_METER * hdop / GPS_DOP_SCALE;
+		// 64-bit: altitude gate of HDOP above ~429 does not fit int32_t
+		int64_t alt_gate = (int64_t)2 * GPS_FILTER_GATE_M * GPS_ALT_SCALE * hdop / GPS_DOP_SCALE;
+
+		if (labs(sample.lat - filter_signed(filter->pos.lat, filter->pos.lat_dir)) > gate ||
+		    labs(sample.lon - filter_signed(filter->pos.lon, filter->pos.lon_dir)) > gate ||
+		    llabs((int64_t)sample.alt - filter->pos.alt) > alt_gate) {
+			filter->outliers++;
+
+			if (++filter->rejects_in_row < GPS_FILTER_MAX_REJECTS)
+				return GPS_MESSAGE_INVALID;
+
+			// start again from the new fix
+			filter->count = 0;
+			filter->oldest = 0;
+			filter->sum_lat = 0;
+			filter->sum_lon = 0;
+			filter->sum_alt = 0;
+			filter->sum_weight = 0;
+		}
+	}
+
+	filter->rejects_in_row = 0;
+
+	if (filter->count == filter->window) {
+		// window is full; replace the oldest fix
+		struct NEO6_FilterSample *old = &filter->samples[filter->oldest];
+
+		filter->sum_lat -= (int64_t)old->lat * old->weight;
+		filter->sum_lon -= (int64_t)old->lon * old->weight;
+		filter->sum_alt -= (int64_t)old->alt * old->weight;
+		filter->sum_weight -= old->weight;
+
+		idx = filter->oldest;
+		filter->oldest = (filter->oldest + 1) % filter->window;
+	}
+	else {
+		idx = (filter->oldest + filter->count) % filter->window;
+		filter->count++;
+	}
+
+	filter->samples[idx] = sample;
+	filter->sum_lat += (int64_t)sample.lat * sample.weight;
+	filter->sum_lon += (int64_t)sample.lon * sample.weight;
+	filter->sum_alt += (int64_t)sample.alt * sample.weight;
+	filter->sum_weight += sample.weight;
+
+	filter_output(filter);
+
+	return GPS_OK;
+}
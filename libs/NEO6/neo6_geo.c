@@ -0,0 +1,302 @@
+#include <stdlib.h>
+#include "main.h"
+
+#include "neo6.h"
+
+
+/**  --------------------------- INTERNAL FUNCTIONS ---------------------------  **/
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * atan(0 .. 1) in steps of 1/64, 0.01 degrees
+ *
+*/
+static const int16_t atan_table[65] = {
+	0, 90, 179, 268, 358, 447, 536, 624, 713, 800, 888,
+	975, 1062, 1148, 1234, 1319, 1404, 1488, 1571, 1653, 1735, 1817,
+	1897, 1977, 2056, 2134, 2211, 2287, 2363, 2438, 2511, 2584, 2657,
+	2728, 2798, 2867, 2936, 3003, 3070, 3136, 3201, 3264, 3327, 3390,
+	3451, 3511, 3571, 3629, 3687, 3744, 3800, 3855, 3909, 3963, 4016,
+	4067, 4119, 4169, 4218, 4267, 4315, 4363, 4409, 4455, 4500,
+};
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief atan of ratio 0 .. 1 in Q12, table lookup with linear interpolation
+ *
+ * @retval (int32_t) angle in 0.01 degrees (0 .. 4500)
+*/
+int32_t geo_atan(uint32_t ratio)
+{
+	uint32_t idx = ratio >> 6;
+	int32_t frac = ratio & 63;
+	int32_t value = atan_table[idx];
+
+	if (frac)
+		value += (atan_table[idx + 1] - value) * frac / 64;
+
+	return value;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Cosine in Q30 for degree lengths, Taylor series to x^8 in 0 .. 45 degrees (error < 1e-7)
+ *
+ * NEO6_CosQ15(...) (Q15 table, 0.01 degree steps) is off by up to 3.5e-4 of the length
+ *  at high latitudes, 3.5 m in 10 km
+ *
+ * @param angle: angle in 1e-7 degrees (-360 .. 360 degrees)
+ *
+ * @retval (int32_t) cosine in Q30
+*/
+int32_t geo_cos_q30(int64_t angle)
+{
+	// pi / 180e7 (radians of 1e-7 degrees) in Q60
+	const int64_t rad_q60 = 2012227627LL;
+	int64_t half = 180LL * GPS_COORD_SCALE;
+	int32_t sign = 1;
+	uint8_t sine = 0;
+	int64_t x, x2, value;
+
+	if (angle < 0)
+		angle = -angle;
+	angle %= 2 * half;
+	if (angle > half)
+		angle = 2 * half - angle;
+	if (angle > half / 2) {
+		angle = half - angle;
+		sign = -1;
+	}
+	// cos(a) = sin(90 - a), smaller x of the two series
+	if (angle > half / 4) {
+		angle = half / 2 - angle;
+		sine = 1;
+	}
+
+	x = (angle * rad_q60) >> 30;
+	x2 = (x * x) >> 30;
+
+	// Horner: cos = 1 - x^2/(1*2) (1 - x^2/(3*4) (...)), sin = x (1 - x^2/(2*3) (1 - x^2/(4*5) (...)))
+	value = 1LL << 30;
+	for (uint8_t n = 8; n; n -= 2)
+		value = (1LL << 30) - ((x2 * value) >> 30) / (sine ? n * (n + 1) : (n - 1) * n);
+
+	if (sine)
+		value = (x * value) >> 30;
+
+	return (int32_t)(sign * value);
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Length of 1e-7 degrees of latitude and longtitude in mm, Q16 (WGS84 series)
+ *
+ * @param lat: latitude in 1e-7 degrees
+ *
+*/
+int32_t geo_lat_scale(int32_t lat)
+{
+	// 111132.92 - 559.82 cos(2 lat) + 1.175 cos(4 lat) metres per degree
+	int64_t mm_per_deg = 111132920LL + ((-559820LL * geo_cos_q30(2LL * lat) + 1175LL * geo_cos_q30(4LL * lat)) >> 30);
+
+	return (int32_t)((mm_per_deg << 16) / GPS_COORD_SCALE);
+}
+
+int32_t geo_lon_scale(int32_t lat)
+{
+	// 111412.84 cos(lat) - 93.5 cos(3 lat) metres per degree
+	int64_t mm_per_deg = (111412840LL * geo_cos_q30(lat) - 93500LL * geo_cos_q30(3LL * lat)) >> 30;
+
+	return (int32_t)((mm_per_deg << 16) / GPS_COORD_SCALE);
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Integer square root (floor)
+ *
+*/
+uint32_t geo_sqrt(uint64_t value)
+{
+	uint64_t root = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > value)
+		bit >>= 2;
+
+	while (bit) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+			root >>= 1;
+		bit >>= 2;
+	}
+
+	return (uint32_t)root;
+}
+
+
+/** --------------------------- LIBRARY FUNCTIONS --------------------------- **/
+
+/**
+ * @brief Convert position to signed coordinates (negative for S and W)
+ *
+ * @param pos: Pointer to position (e.g. &gps->info.pos)
+ * @param lat: Pointer to store latitude in 1e-7 degrees
+ * @param lon: Pointer to store longtitude in 1e-7 degrees
+ *
+ * @retval void
+*/
+void NEO6_GeoSigned(const struct position_data *pos, int32_t *lat, int32_t *lon)
+{
+	*lat = (pos->lat_dir == 'S') ? -pos->lat : pos->lat;
+	*lon = (pos->lon_dir == 'W') ? -pos->lon : pos->lon;
+}
+
+
+/**
+ * @brief Angle of vector (x, y) from x axis towards y axis, table lookup
+ *
+ * @param y, x: components of the vector (any common unit)
+ *
+ * @retval (int32_t) angle in 0.01 degrees (-18000 .. 18000), 0 for zero vector
+*/
+int32_t NEO6_Atan2(int32_t y, int32_t x)
+{
+	uint32_t ax = (x < 0) ? 0U - (uint32_t)x : (uint32_t)x;
+	uint32_t ay = (y < 0) ? 0U - (uint32_t)y : (uint32_t)y;
+	int32_t angle;
+
+	if (!ax && !ay)
+		return 0;
+
+	// reduce to the first octant
+	if (ay <= ax)
+		angle = geo_atan((uint32_t)(((uint64_t)ay << 12) / ax));
+	else
+		angle = 9000 - geo_atan((uint32_t)(((uint64_t)ax << 12) / ay));
+
+	if (x < 0)
+		angle = 18000 - angle;
+
+	return (y < 0) ? -angle : angle;
+}
+
+
+/**
+ * @brief Set reference point of local east-north-up (ENU) coordinates (e.g. launch site)
+ *
+ * @param ref: Pointer to reference struct
+ * @param pos: Pointer to reference position
+ *
+ * @retval void
+*/
+void NEO6_GeoSetRef(struct NEO6_GeoRef *ref, const struct position_data *pos)
+{
+	NEO6_GeoSigned(pos, &ref->lat, &ref->lon);
+	ref->alt = pos->alt;
+	ref->lat_scale = geo_lat_scale(ref->lat);
+	ref->lat_sin = NEO6_SinQ15(ref->lat / (GPS_COORD_SCALE / 100));
+	ref->lat_cos = NEO6_CosQ15(ref->lat / (GPS_COORD_SCALE / 100));
+
+	// tan(lat) is limited near the poles
+	if (ref->lat_cos < GPS_PREDICT_MIN_COS)
+		ref->lat_cos = GPS_PREDICT_MIN_COS;
+}
+
+
+/**
+ * @brief Convert position to local east-north-up offsets from the reference point
+ *
+ * Offsets in the tangent plane at the reference from WGS84 degree lengths,
+ *  with second order correction of north offset (meridian convergence)
+ *
+ * @param ref: Pointer to reference set by NEO6_GeoSetRef(...)
+ * @param pos: Pointer to position (e.g. &gps->info.pos or filtered one)
+ * @param enu: Pointer to struct to store offsets in mm
+ *
+ * @retval void
+*/
+void NEO6_GeoToENU(const struct NEO6_GeoRef *ref, const struct position_data *pos, struct NEO6_ENU *enu)
+{
+	int32_t lat, lon;
+	int64_t d_lat, d_lon;
+
+	NEO6_GeoSigned(pos, &lat, &lon);
+
+	d_lat = (int64_t)lat - ref->lat;
+	d_lon = (int64_t)lon - ref->lon;
+
+	// shorter way around the antimeridian
+	if (d_lon > 180 * GPS_COORD_SCALE)
+		d_lon -= 360 * GPS_COORD_SCALE;
+	else if (d_lon < -180 * GPS_COORD_SCALE)
+		d_lon += 360 * GPS_COORD_SCALE;
+
+	enu->east = (int32_t)((d_lon * geo_lon_scale(lat)) >> 16);
+	// meridians converge; tangent plane north grows with east^2 * tan(lat) / 2R
+	enu->north = (int32_t)(((d_lat * ref->lat_scale) >> 16) + 
+			       (int64_t)enu->east * enu->east / (2 * GPS_EARTH_RADIUS_MM) * ref->lat_sin / ref->lat_cos);
+	enu->up = pos->alt - ref->alt;
+}
+
+
+/**
+ * @brief Horizontal distance of ENU offsets
+ *
+ * @param enu: Pointer to offsets from NEO6_GeoToENU(...)
+ *
+ * @retval (uint32_t) distance in mm
+*/
+uint32_t NEO6_GeoDistance(const struct NEO6_ENU *enu)
+{
+	return geo_sqrt((uint64_t)((int64_t)enu->east * enu->east) + (uint64_t)((int64_t)enu->north * enu->north));
+}
+
+
+/**
+ * @brief Bearing of ENU offsets (from the reference point), clockwise from north
+ *
+ * @param enu: Pointer to offsets from NEO6_GeoToENU(...)
+ *
+ * @retval (uint16_t) bearing in 0.01 degrees (0 .. 35999), same unit as course
+*/
+uint16_t NEO6_GeoBearing(const struct NEO6_ENU *enu)
+{
+	int32_t bearing = NEO6_Atan2(enu->east, enu->north);
+
+	return (uint16_t)((bearing < 0) ? bearing + 36000 : bearing % 36000);
+}
+
+
+/**
+ * @brief Distance and bearing from one position to another (e.g. to landing target)
+ *
+ * @param from: Pointer to current position
+ * @param to: Pointer to target position
+ * @param distance: Pointer to store horizontal distance in mm
+ * @param bearing: Pointer to store bearing in 0.01 degrees, clockwise from north
+ *
+ * @retval void
+*/
+void NEO6_GeoDistanceBearing(const struct position_data *from, const struct position_data *to, uint32_t *distance, uint16_t *bearing)
+{
+	struct NEO6_GeoRef ref;
+	struct NEO6_ENU enu;
+
+	NEO6_GeoSetRef(&ref, from);
+	NEO6_GeoToENU(&ref, to, &enu);
+
+	*distance = NEO6_GeoDistance(&enu);
+	*bearing = NEO6_GeoBearing(&enu);
+}
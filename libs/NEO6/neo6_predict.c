@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include "main.h"
+
+#include "neo6.h"
+
+
+/**  --------------------------- INTERNAL FUNCTIONS ---------------------------  **/
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * sin(0 .. 90 degrees) in steps of 1 degree, Q15
+ *
+*/
+static const int16_t sin_table[91] = {
+	0, 572, 1144, 1715, 2286, 2856, 3425, 3993, 4560, 5126,
+	5690, 6252, 6813, 7371, 7927, 8481, 9032, 9580, 10126, 10668,
+	11207, 11743, 12275, 12803, 13328, 13848, 14364, 14876, 15383, 15886,
+	16383, 16876, 17364, 17846, 18323, 18794, 19260, 19720, 20173, 20621,
+	21062, 21497, 21925, 22347, 22762, 23170, 23571, 23964, 24351, 24730,
+	25101, 25465, 25821, 26169, 26509, 26841, 27165, 27481, 27788, 28087,
+	28377, 28659, 28932, 29196, 29451, 29697, 29934, 30162, 30381, 30591,
+	30791, 30982, 31163, 31335, 31498, 31650, 31794, 31927, 32051, 32165,
+	32269, 32364, 32448, 32523, 32587, 32642, 32687, 32722, 32747, 32762,
+	32767,
+};
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Extrapolate value by rate (units per second) over dt_ms
+ *
+*/
+int32_t predict_step(int32_t value, int32_t rate, uint32_t dt_ms)
+{
+	return value + (int32_t)((int64_t)rate * dt_ms / 1000);
+}
+
+
+/** --------------------------- LIBRARY FUNCTIONS --------------------------- **/
+
+/**
+ * @brief Sine of angle, table lookup with linear interpolation
+ *
+ * @param angle: angle in 0.01 degrees (any value, e.g. course of struct NEO6_ParsedInfo)
+ *
+ * @retval (int32_t) sine in Q15 (-32767 .. 32767)
+*/
+int32_t NEO6_SinQ15(int32_t angle)
+{
+	int32_t sign = 1;
+	int32_t idx, frac, value;
+
+	angle %= 36000;
+	if (angle < 0)
+		angle += 36000;
+
+	if (angle >= 18000) {
+		angle -= 18000;
+		sign = -1;
+	}
+	if (angle > 9000)
+		angle = 18000 - angle;
+
+	idx = angle / 100;
+	frac = angle % 100;
+
+	value = sin_table[idx];
+	if (frac)
+		value += (sin_table[idx + 1] - value) * frac / 100;
+
+	return sign * value;
+}
+
+
+/**
+ * @brief Cosine of angle, see NEO6_SinQ15(...)
+ *
+ * @param angle: angle in 0.01 degrees
+ *
+ * @retval (int32_t) cosine in Q15 (-32767 .. 32767)
+*/
+int32_t NEO6_CosQ15(int32_t angle)
+{
+	return NEO6_SinQ15(angle + 9000);
+}
+
+
+/**
+ * @brief Clear position predictor; NEO6_Predict(...) fails until the next fix
+ *
+ * @param pred: Pointer to position predictor (e.g. &gps->predict)
+ *
+ * @retval void
+*/
+void NEO6_PredictInit(struct NEO6_Predictor *pred)
+{
+	pred->valid = 0;
+	pred->lat = 0;
+	pred->lon = 0;
+	pred->alt = 0;
+	pred->tick = 0;
+	pred->v_lat = 0;
+	pred->v_lon = 0;
+
+	pred->baro_valid = 0;
+	pred->baro_alt = 0;
+	pred->baro_tick = 0;
+	pred->v_alt = 0;
+}
+
+
+/**
+ * @brief Restart prediction from the new fix; called by the driver for every valid position
+ *
+ * Ground velocity is converted from speed and course to 1e-7 degrees
+ *  per second once here, so that NEO6_Predict(...) only multiplies
+ *
+ * @param pred: Pointer to position predictor
+ * @param info: Pointer to parsed info of the fix (position, speed and course)
+ * @param tick: HAL tick of the fix
+ *
+ * @retval void
+*/
+void NEO6_PredictUpdate(struct NEO6_Predictor *pred, const struct NEO6_ParsedInfo *info, uint32_t tick)
+{
+	int32_t lat = (info->pos.lat_dir == 'S') ? -info->pos.lat : info->pos.lat;
+	int32_t lon = (info->pos.lon_dir == 'W') ? -info->pos.lon : info->pos.lon;
+	// cm/s to north and east
+	int32_t v_north = (int32_t)info->speed * NEO6_CosQ15(info->course) >> 15;
+	int32_t v_east = (int32_t)info->speed * NEO6_SinQ15(info->course) >> 15;
+	// longtitude degrees shrink with cos(latitude); limited near the poles
+	int32_t lat_cos = NEO6_CosQ15(lat / (GPS_COORD_SCALE / 100));
+
+	if (lat_cos < GPS_PREDICT_MIN_COS)
+		lat_cos = GPS_PREDICT_MIN_COS;
+
+	pred->lat = lat;
+	pred->lon = lon;
+	pred->alt = info->pos.alt;
+	pred->tick = tick;
+
+	pred->v_lat = v_north * GPS_COORD_PER_METER / 100;
+	pred->v_lon = (int32_t)(((int64_t)v_east * GPS_COORD_PER_METER << 15) / (100 * lat_cos));
+
+	pred->valid = 1;
+}
+
+
+/**
+ * @brief Update vertical rate from barometric altitude (e.g. BME280 readings)
+ *
+ * Rate is smoothed over consecutive samples; samples closer than
+ *  GPS_PREDICT_BARO_MIN_MS to the previous used one are skipped
+ *
+ * @param pred: Pointer to position predictor (e.g. &gps->predict)
+ * @param alt: barometric altitude in mm (only differences are used, so any reference is fine)
+ * @param tick: HAL tick of the reading
+ *
+ * @note Call it from the same task as NEO6_Predict(...); it is not covered
+ * 	 by the update counter of the driver
+ *
+ * @retval void
+*/
+void NEO6_PredictBaro(struct NEO6_Predictor *pred, int32_t alt, uint32_t tick)
+{
+	uint32_t dt_ms = tick - pred->baro_tick;
+
+	if (!pred->baro_valid || dt_ms > GPS_PREDICT_MAX_MS) {
+		// first or stale reading; no rate yet
+		pred->v_alt = 0;
+	}
+	else if (dt_ms < GPS_PREDICT_BARO_MIN_MS) {
+		return ;
+	}
+	else {
+		int32_t rate = (int32_t)((int64_t)(alt - pred->baro_alt) * 1000 / (int32_t)dt_ms);
+
+		// first order low-pass, 1/4 of the new rate
+		pred->v_alt += (rate - pred->v_alt) / 4;
+	}
+
+	pred->baro_alt = alt;
+	pred->baro_tick = tick;
+	pred->baro_valid = 1;
+}
+
+
+/**
+ * @brief Extrapolate position of the last fix to given time
+ *
+ * Horizontal position moves with the ground velocity of the fix, altitude
+ *  with barometric vertical rate (if NEO6_PredictBaro(...) is fed);
+ *  time is limited to GPS_PREDICT_MAX_MS after the fix
+ *
+ * @param pred: Pointer to position predictor (e.g. &gps->predict)
+ * @param tick: HAL tick to predict position for (e.g. HAL_GetTick())
+ * @param pos: Pointer to struct to store predicted position
+ *
+ * @retval Status Code
+ * 	GPS_OK - position is predicted
+ * 	GPS_MESSAGE_INVALID - there was no fix yet
+ * 	HAL_TIMEOUT - fix is older than GPS_PREDICT_MAX_MS; position is extrapolated up to that limit
+*/
+uint8_t NEO6_Predict(const struct NEO6_Predictor *pred, uint32_t tick, struct position_data *pos)
+{
+	uint8_t status = GPS_OK;
+	uint32_t dt_ms = tick - pred->tick;
+	int32_t lat, lon, alt;
+
+	if (!pred->valid)
+		return GPS_MESSAGE_INVALID;
+
+	// tick before the fix (wrapped difference)
+	if (dt_ms > UINT32_MAX / 2)
+		dt_ms = 0;
+	else if (dt_ms > GPS_PREDICT_MAX_MS) {
+		dt_ms = GPS_PREDICT_MAX_MS;
+		status = HAL_TIMEOUT;
+	}
+
+	lat = predict_step(pred->lat, pred->v_lat, dt_ms);
+	lon = predict_step(pred->lon, pred->v_lon, dt_ms);
+	alt = pred->alt;
+
+	// stale barometric rate is not used
+	if (pred->baro_valid && tick - pred->baro_tick <= GPS_PREDICT_MAX_MS)
+		alt = predict_step(alt, pred->v_alt, dt_ms);
+
+	pos->lat = labs(lat);
+	pos->lat_dir = (lat < 0) ? 'S' : 'N';
+
+	pos->lon = labs(lon);
+	pos->lon_dir = (lon < 0) ? 'W' : 'E';
+
+	pos->alt = alt;
+
+	return status;
+}
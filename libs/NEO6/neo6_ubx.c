@@ -0,0 +1,396 @@
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+
+#include "neo6.h"
+
+
+/**  --------------------------- INTERNAL FUNCTIONS ---------------------------  **/
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Read little endian values from UBX payload (payload is not aligned)
+ *
+*/
+uint16_t ubx_u16(const uint8_t *data)
+{
+	return (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+}
+
+int32_t ubx_i32(const uint8_t *data)
+{
+	return (int32_t)((uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+			 ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Update checksum of UBX parser with given byte (8-bit Fletcher algorithm)
+ *
+*/
+void ubx_checksum(struct UBX_Parser *parser, uint8_t byte)
+{
+	parser->ck_a += byte;
+	parser->ck_b += parser->ck_a;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * Start new navigation epoch if the message has other iTOW than the previous ones
+ *
+*/
+void ubx_epoch_begin(struct UBX_Parser *parser, uint32_t itow)
+{
+	if (parser->epoch_parts && parser->epoch_itow == itow)
+		return ;
+
+	parser->epoch_itow = itow;
+	parser->epoch_parts = 0;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * Parse NAV-POSLLH payload; position waits for NAV-SOL of the same epoch, see UBX_EpochStore
+ *
+*/
+void UBX_NavPosllhParse(struct UBX_Parser *parser, const uint8_t *payload)
+{
+	ubx_epoch_begin(parser, (uint32_t)ubx_i32(payload));
+
+	// UBX uses the same units (1e-7 degrees, mm) as position_data
+	parser->epoch_lon = ubx_i32(payload + 4);
+	parser->epoch_lat = ubx_i32(payload + 8);
+
+	// height above mean sea level
+	parser->epoch_alt = ubx_i32(payload + 16);
+
+	parser->epoch_parts |= UBX_EPOCH_POSLLH;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * Parse NAV-SOL payload; quality of fix, DOP and number of satellites
+ *
+*/
+void UBX_NavSolParse(struct UBX_Parser *parser, const uint8_t *payload, struct NEO6_ParsedInfo *info)
+{
+	uint8_t fix_type = payload[10];
+	uint8_t flags = payload[11];
+
+	ubx_epoch_begin(parser, (uint32_t)ubx_i32(payload));
+	parser->epoch_parts |= UBX_EPOCH_SOL;
+
+	// position DOP (0.01), closest to HDOP in this message
+	info->hdop = ubx_u16(payload + 44);
+	info->satellites = payload[47];
+
+	// 2D, 3D and GPS + dead reckoning fixes within limits (GPSfixOK)
+	if ((flags & 0x01) && fix_type >= 0x02 && fix_type <= 0x04)
+		info->quality = (flags & 0x02) ? 2 : 1; // DGPS if DiffSoln
+	else
+		info->quality = 0;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * Parse NAV-VELNED payload; speed and course wait for the position of the same epoch
+ *
+*/
+void UBX_NavVelnedParse(struct UBX_Parser *parser, const uint8_t *payload)
+{
+	// ground speed in cm/s, heading of motion in 1e-5 degrees (0 .. 360)
+	uint32_t speed = (uint32_t)ubx_i32(payload + 20);
+	int32_t heading = ubx_i32(payload + 24);
+
+	ubx_epoch_begin(parser, (uint32_t)ubx_i32(payload));
+
+	// same units as RMC and VTG (cm/s, 0.01 degrees)
+	parser->epoch_speed = (speed > UINT16_MAX) ? UINT16_MAX : (uint16_t)speed;
+	parser->epoch_course = (heading > 0 && heading < 36000000) ? (uint16_t)(heading / 1000) : 0;
+
+	parser->epoch_parts |= UBX_EPOCH_VELNED;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * Parse NAV-TIMEUTC payload; time and date are stored only if UTC is valid
+ *
+*/
+void UBX_NavTimeUtcParse(const uint8_t *payload, struct NEO6_ParsedInfo *info)
+{
+	struct NEO6_DateTime dt = {
+		.year = ubx_u16(payload + 12),
+		.month = payload[14],
+		.day = payload[15],
+		.hour = payload[16],
+		.minute = payload[17],
+		.second = payload[18]
+	};
+	// fraction of second in ns, -1e9 .. 1e9 (rounded to the nearest second above)
+	int32_t nano = ubx_i32(payload + 8);
+	uint32_t utc_time;
+
+	// validUTC flag
+	if (!(payload[19] & 0x04))
+		return ;
+
+	utc_time = NEO6_MakeTime(&dt);
+	if (nano < 0) {
+		utc_time--;
+		nano += 1000000000;
+	}
+
+	info->utc_time = utc_time;
+	info->utc_ms = (uint16_t)(nano / 1000000);
+}
+
+
+/** --------------------------- LIBRARY FUNCTIONS --------------------------- **/
+
+/**
+ * @brief Reset UBX parser; following bytes are ignored until sync chars are received
+ *
+ * @param parser: Pointer to UBX parser state
+ *
+ * @retval void
+*/
+void UBX_ParserReset(struct UBX_Parser *parser)
+{
+	parser->state = UBX_STATE_SYNC_1;
+	parser->msg_class = 0;
+	parser->msg_id = 0;
+	parser->length = 0;
+	parser->index = 0;
+	parser->ck_a = 0;
+	parser->ck_b = 0;
+}
+
+
+/**
+ * @brief Feed single received byte to the UBX frame parser
+ *
+ * @param parser: Pointer to UBX parser state
+ * @param byte: received byte
+ *
+ * @retval Status Code
+ * 	GPS_MSG_CPLT - frame with valid checksum is completed, see parser->msg_class, msg_id and payload
+ * 	GPS_MESSAGE_INVALID - frame is dropped because of wrong checksum
+ * 	GPS_BUF_FULL - payload does not fit UBX_PAYLOAD_SIZE, frame is dropped
+ * 	GPS_CHR_RECEIVED - otherwise
+*/
+uint8_t UBX_ParseByte(struct UBX_Parser *parser, uint8_t byte)
+{
+	switch (parser->state) {
+	case UBX_STATE_SYNC_1:
+		if (byte == UBX_SYNC_CHAR_1)
+			parser->state = UBX_STATE_SYNC_2;
+		break;
+
+	case UBX_STATE_SYNC_2:
+		if (byte == UBX_SYNC_CHAR_2) {
+			UBX_ParserReset(parser);
+			parser->state = UBX_STATE_CLASS;
+		}
+		else if (byte != UBX_SYNC_CHAR_1)
+			parser->state = UBX_STATE_SYNC_1;
+		break;
+
+	case UBX_STATE_CLASS:
+		parser->msg_class = byte;
+		ubx_checksum(parser, byte);
+		parser->state = UBX_STATE_ID;
+		break;
+
+	case UBX_STATE_ID:
+		parser->msg_id = byte;
+		ubx_checksum(parser, byte);
+		parser->state = UBX_STATE_LENGTH_1;
+		break;
+
+	case UBX_STATE_LENGTH_1:
+		parser->length = byte;
+		ubx_checksum(parser, byte);
+		parser->state = UBX_STATE_LENGTH_2;
+		break;
+
+	case UBX_STATE_LENGTH_2:
+		parser->length |= (uint16_t)byte << 8;
+		ubx_checksum(parser, byte);
+
+		if (parser->length > UBX_PAYLOAD_SIZE) {
+			parser->state = UBX_STATE_SYNC_1;
+			return GPS_BUF_FULL;
+		}
+
+		parser->state = parser->length ? UBX_STATE_PAYLOAD : UBX_STATE_CK_A;
+		break;
+
+	case UBX_STATE_PAYLOAD:
+		parser->payload[parser->index++] = byte;
+		ubx_checksum(parser, byte);
+
+		if (parser->index >= parser->length)
+			parser->state = UBX_STATE_CK_A;
+		break;
+
+	case UBX_STATE_CK_A:
+		if (byte != parser->ck_a) {
+			parser->state = UBX_STATE_SYNC_1;
+			return GPS_MESSAGE_INVALID;
+		}
+		parser->state = UBX_STATE_CK_B;
+		break;
+
+	case UBX_STATE_CK_B:
+		parser->state = UBX_STATE_SYNC_1;
+		if (byte != parser->ck_b)
+			return GPS_MESSAGE_INVALID;
+
+		return GPS_MSG_CPLT;
+
+	default:
+		UBX_ParserReset(parser);
+		break;
+	}
+
+	return GPS_CHR_RECEIVED;
+}
+
+
+/**
+ * @brief Store information of the completed UBX frame (NAV-POSLLH, NAV-SOL, NAV-VELNED, NAV-TIMEUTC)
+ *
+ * Each message updates only its own part of info, so info should hold
+ *  values of previous messages; position and velocity are stored by 
+ *  UBX_EpochStore(...) once NAV-SOL and NAV-VELNED of its epoch have been received
+ *
+ * @param parser: Pointer to UBX parser state, after GPS_MSG_CPLT is returned
+ * @param info: Pointer to NEO6 gps info struct to store parsed information
+ *
+ * @retval Status Code
+ * 	GPS_MSG_CPLT - frame is used
+ * 	GPS_MESSAGE_INVALID - frame is unknown or too short
+*/
+uint8_t UBX_MessageParse(struct UBX_Parser *parser, struct NEO6_ParsedInfo *info)
+{
+	if (parser->msg_class != UBX_CLASS_NAV)
+		return GPS_MESSAGE_INVALID;
+
+	if (parser->msg_id == UBX_NAV_POSLLH && parser->length >= 28)
+		UBX_NavPosllhParse(parser, parser->payload);
+	else if (parser->msg_id == UBX_NAV_SOL && parser->length >= 52)
+		UBX_NavSolParse(parser, parser->payload, info);
+	else if (parser->msg_id == UBX_NAV_VELNED && parser->length >= 36)
+		UBX_NavVelnedParse(parser, parser->payload);
+	else if (parser->msg_id == UBX_NAV_TIMEUTC && parser->length >= 20)
+		UBX_NavTimeUtcParse(parser->payload, info);
+	else
+		return GPS_MESSAGE_INVALID;
+
+	return GPS_MSG_CPLT;
+}
+
+
+/**
+ * @brief Forget the navigation epoch being received (e.g. after protocol change)
+ *
+ * @param parser: Pointer to UBX parser state
+ *
+ * @retval void
+*/
+void UBX_EpochReset(struct UBX_Parser *parser)
+{
+	parser->epoch_itow = 0;
+	parser->epoch_parts = 0;
+}
+
+
+/**
+ * @brief Store position and velocity of the epoch once its NAV-POSLLH, NAV-SOL and 
+ * 	  NAV-VELNED are parsed
+ *
+ * The module sends NAV-POSLLH before NAV-SOL and NAV-VELNED, so position is paired 
+ *  with the fix and velocity of its own epoch (by iTOW) instead of the ones of the 
+ *  previous epoch (NEO6_PredictUpdate(...) extrapolates with this velocity)
+ *
+ * @param parser: Pointer to UBX parser state, after UBX_MessageParse(...)
+ * @param info: Pointer to NEO6 gps info struct to store position, speed and course to
+ *
+ * @retval (uint8_t) 1 if new position is stored (once per epoch, valid fix only), 0 otherwise
+*/
+uint8_t UBX_EpochStore(struct UBX_Parser *parser, struct NEO6_ParsedInfo *info)
+{
+	if (parser->epoch_parts != (UBX_EPOCH_POSLLH | UBX_EPOCH_SOL | UBX_EPOCH_VELNED))
+		return 0;
+
+	parser->epoch_parts |= UBX_EPOCH_STORED;
+
+	if (!info->quality)
+		return 0;
+
+	info->pos.lat = labs(parser->epoch_lat);
+	info->pos.lat_dir = (parser->epoch_lat < 0) ? 'S' : 'N';
+
+	info->pos.lon = labs(parser->epoch_lon);
+	info->pos.lon_dir = (parser->epoch_lon < 0) ? 'W' : 'E';
+
+	info->pos.alt = parser->epoch_alt;
+
+	info->speed = parser->epoch_speed;
+	info->course = parser->epoch_course;
+
+	return 1;
+}
+
+
+/**
+ * @brief Build UBX frame (sync chars, header, payload and checksum)
+ *
+ * @param frame: Pointer to output buffer, at least length + UBX_FRAME_OVERHEAD bytes
+ * @param msg_class: class of the message (e.g. UBX_CLASS_CFG)
+ * @param msg_id: id of the message (e.g. UBX_CFG_MSG)
+ * @param payload: Pointer to payload, may be NULL if length is 0 (poll request)
+ * @param length: size of payload
+ *
+ * @retval (uint16_t) size of the frame
+*/
+uint16_t UBX_BuildFrame(uint8_t *frame, uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length)
+{
+	uint8_t ck_a = 0, ck_b = 0;
+	uint16_t size = 0;
+
+	frame[size++] = UBX_SYNC_CHAR_1;
+	frame[size++] = UBX_SYNC_CHAR_2;
+	frame[size++] = msg_class;
+	frame[size++] = msg_id;
+	frame[size++] = (uint8_t)length;
+	frame[size++] = (uint8_t)(length >> 8);
+
+	if (length)
+		memcpy(frame + size, payload, length);
+	size += length;
+
+	// checksum over class, id, length and payload
+	for (uint16_t i = 2; i < size; i++) {
+		ck_a += frame[i];
+		ck_b += ck_a;
+	}
+
+	frame[size++] = ck_a;
+	frame[size++] = ck_b;
+
+	return size;
+}
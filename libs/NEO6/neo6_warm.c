@@ -0,0 +1,240 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+
+#include "neo6.h"
+
+
+// neo6.c
+uint8_t ubx_send(struct NEO6 *gps, uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length, uint8_t wait_ack);
+
+
+/**  --------------------------- INTERNAL FUNCTIONS ---------------------------  **/
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief CRC-32 (IEEE 802.3) of warm start data without the crc field
+ *
+*/
+uint32_t warm_crc(const struct NEO6_WarmData *data)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	uint32_t crc = 0xFFFFFFFFUL;
+
+	for (uint16_t i = 0; i < offsetof(struct NEO6_WarmData, crc); i++) {
+		crc ^= bytes[i];
+		for (uint8_t bit = 0; bit < 8; bit++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320UL : 0);
+	}
+
+	return ~crc;
+}
+
+
+/**
+ * INTERNAL FUNCTION
+ *
+ * @brief Write little endian value to UBX payload
+ *
+*/
+void warm_put32(uint8_t *payload, uint32_t value)
+{
+	payload[0] = (uint8_t)value;
+	payload[1] = (uint8_t)(value >> 8);
+	payload[2] = (uint8_t)(value >> 16);
+	payload[3] = (uint8_t)(value >> 24);
+}
+
+
+/** --------------------------- LIBRARY FUNCTIONS --------------------------- **/
+
+/**
+ * @brief Fill warm start data with the current fix and ephemerides polled from the module (AID-EPH)
+ *
+ * Blocks until all AID-EPH responses are received or GPS_AID_TIMEOUT elapses;
+ *  up to GPS_WARM_MAX_EPH satellites with ephemeris are stored
+ *
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param data: Pointer to warm start data (about 1 kB, e.g. static), then stored with NEO6_WarmSave(...)
+ *
+ * @note In GPS_PARSE_IN_TASK mode the parsing task must run meanwhile (same as for NEO6_Configure)
+ *
+ * @retval Status Code
+ * 	GPS_OK - data is filled (possibly without ephemerides)
+ * 	GPS_MESSAGE_INVALID - there is no valid fix to store
+ * 	HAL_* - snapshot or transmission failed
+*/
+uint8_t NEO6_WarmCollect(struct NEO6 *gps, struct NEO6_WarmData *data)
+{
+	struct NEO6_Fix fix;
+	uint8_t result;
+
+	if (gps == NULL || data == NULL)
+		return GPS_ERR_NULL_PTR;
+
+	data->magic = 0;
+
+	result = NEO6_GetFix(gps, &fix);
+	if (result != GPS_OK)
+		return result;
+
+	if (!fix.info.quality)
+		return GPS_MESSAGE_INVALID;
+
+	data->utc_time = fix.info.utc_time;
+	data->lat = (fix.info.pos.lat_dir == 'S') ? -fix.info.pos.lat : fix.info.pos.lat;
+	data->lon = (fix.info.pos.lon_dir == 'W') ? -fix.info.pos.lon : fix.info.pos.lon;
+	data->alt = fix.info.pos.alt;
+	data->eph_count = 0;
+	memset(data->reserved, 0, sizeof(data->reserved));
+	memset(data->eph, 0, sizeof(data->eph));
+
+	// responses are stored by ubx_calc_info while warm is set
+	gps->com.warm_received = 0;
+	gps->com.warm = data;
+
+	result = ubx_send(gps, UBX_CLASS_AID, UBX_AID_EPH, NULL, 0, 0);
+	if (result == HAL_OK) {
+		uint32_t start = HAL_GetTick();
+
+		while (gps->com.warm_received < UBX_AID_EPH_COUNT && HAL_GetTick() - start < GPS_AID_TIMEOUT)
+			;
+	}
+
+	gps->com.warm = NULL;
+
+	if (result != HAL_OK)
+		return result;
+
+	data->magic = GPS_WARM_MAGIC;
+	data->crc = warm_crc(data);
+
+	return GPS_OK;
+}
+
+
+/**
+ * @brief Write warm start data to flash page at GPS_WARM_FLASH_ADDR
+ *
+ * Page is not rewritten if it already holds the same data
+ *
+ * @param data: Pointer to data filled by NEO6_WarmCollect(...)
+ *
+ * @note CPU stalls while the page is erased (~20 ms); DMA reception goes on
+ *
+ * @retval Status Code (From HAL or GPS)
+*/
+uint8_t NEO6_WarmSave(const struct NEO6_WarmData *data)
+{
+	const uint32_t *words = (const uint32_t *)data;
+	FLASH_EraseInitTypeDef erase = { 0 };
+	uint32_t page_error;
+	uint8_t result;
+
+	if (data == NULL)
+		return GPS_ERR_NULL_PTR;
+
+	if (NEO6_WarmValid(data) != GPS_OK)
+		return GPS_MESSAGE_INVALID;
+
+	// flash wears out with erasing
+	if (memcmp((const void *)GPS_WARM_FLASH_ADDR, data, sizeof(*data)) == 0)
+		return GPS_OK;
+
+	erase.TypeErase = FLASH_TYPEERASE_PAGES;
+	erase.PageAddress = GPS_WARM_FLASH_ADDR;
+	erase.NbPages = 1;
+
+	HAL_FLASH_Unlock();
+
+	result = HAL_FLASHEx_Erase(&erase, &page_error);
+	for (uint16_t i = 0; i < sizeof(*data) / 4 && result == HAL_OK; i++)
+		result = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, GPS_WARM_FLASH_ADDR + i * 4, words[i]);
+
+	HAL_FLASH_Lock();
+
+	return result;
+}
+
+
+/**
+ * @brief Check warm start data (e.g. flash page at GPS_WARM_FLASH_ADDR)
+ *
+ * @param data: Pointer to warm start data
+ *
+ * @retval Status Code
+ * 	GPS_OK - magic and CRC match
+ * 	GPS_MESSAGE_INVALID - otherwise (erased or damaged page)
+*/
+uint8_t NEO6_WarmValid(const struct NEO6_WarmData *data)
+{
+	if (data == NULL)
+		return GPS_ERR_NULL_PTR;
+
+	if (data->magic != GPS_WARM_MAGIC || data->eph_count > GPS_WARM_MAX_EPH || data->crc != warm_crc(data))
+		return GPS_MESSAGE_INVALID;
+
+	return GPS_OK;
+}
+
+
+/**
+ * @brief Send stored position, time and ephemerides to the module (AID-INI, AID-EPH)
+ *
+ * Called from NEO6_Init(...) / NEO6_InitDMA(...) with data in flash if
+ *  GPS_WARM_START is defined
+ *
+ * @param gps: Pointer to NEO6 GPS configuration and received-information struct
+ * @param data: Pointer to valid warm start data
+ * @param utc_now: current UTC time in seconds since 1970-01-01 (e.g. from RTC), 0 if unknown;
+ * 		   ephemerides are sent only if they are not older than GPS_WARM_MAX_AGE,
+ * 		   so with unknown time only the position is sent
+ *
+ * @retval Status Code (From HAL or GPS)
+*/
+uint8_t NEO6_WarmRestore(struct NEO6 *gps, const struct NEO6_WarmData *data, uint32_t utc_now)
+{
+	uint8_t payload[48] = { 0 };
+	uint32_t flags = 0x01 | 0x20; // position valid, given as latitude/longtitude/altitude
+	uint8_t result;
+
+	if (gps == NULL || data == NULL)
+		return GPS_ERR_NULL_PTR;
+
+	if (NEO6_WarmValid(data) != GPS_OK)
+		return GPS_MESSAGE_INVALID;
+
+	// AID-INI: position in 1e-7 degrees and cm, accuracy in cm
+	warm_put32(payload + 0, (uint32_t)data->lat);
+	warm_put32(payload + 4, (uint32_t)data->lon);
+	warm_put32(payload + 8, (uint32_t)(data->alt / 10));
+	warm_put32(payload + 12, GPS_WARM_POS_ACC_M * 100UL);
+
+	if (utc_now) {
+		// GPS time starts at 1980-01-06 and has no leap seconds
+		uint32_t gps_time = utc_now - 315964800UL + GPS_LEAP_SECONDS;
+		uint32_t week = gps_time / 604800;
+
+		payload[18] = (uint8_t)week;
+		payload[19] = (uint8_t)(week >> 8);
+		warm_put32(payload + 20, (gps_time % 604800) * 1000);
+		warm_put32(payload + 28, GPS_WARM_TIME_ACC_MS);
+		flags |= 0x02;
+	}
+	warm_put32(payload + 44, flags);
+
+	result = ubx_send(gps, UBX_CLASS_AID, UBX_AID_INI, payload, sizeof(payload), 0);
+	if (result != HAL_OK)
+		return result;
+
+	// age of ephemerides is unknown without time; stale ones would slow the first fix down
+	if (!utc_now || utc_now < data->utc_time || utc_now - data->utc_time > GPS_WARM_MAX_AGE)
+		return GPS_OK;
+
+	for (uint8_t i = 0; i < data->eph_count && result == HAL_OK; i++)
+		result = ubx_send(gps, UBX_CLASS_AID, UBX_AID_EPH, data->eph[i], UBX_AID_EPH_SIZE, 0);
+
+	return (result == HAL_OK) ? GPS_OK : result;
+}
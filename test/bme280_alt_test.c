@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "main.h"
+
+#include "bme280_lib.h"
+
+/**
+ * Fixed-point altitude (bme280_alt.c) against the barometric formula with pow(...)
+ *
+ * Usage: bme280_alt_test
+ *
+ * For each ground pressure of alt_test_grounds, BME280_Altitude(...) is compared
+ *  with h = 44330.77 m * (1 - (p / p0) ^ 0.190263) in double on a grid of
+ *  ALT_TEST_STEP over 300 .. 1100 hPa; the error must stay within ALT_TEST_MAX_MM_ERROR.
+ *  Then host cycles per conversion of BME280_Altitude(...), powf(...) and pow(...)
+ *  are reported (the host has an FPU, Cortex-M3 has not).
+ *
+ * Exits with 1 if the error is larger
+ *
+*/
+
+#define ALT_TEST_MIN 3000000 // [0.01 Pa]
+#define ALT_TEST_MAX 11000000 // [0.01 Pa]
+#define ALT_TEST_STEP 37 // [0.01 Pa]
+#define ALT_TEST_MAX_MM_ERROR 7.0 // [mm] largest difference allowed
+#define ALT_TEST_SAMPLES 4096 // pressures of the cycle comparison
+#define ALT_TEST_ROUNDS 200
+
+static const uint32_t alt_test_grounds[] = { 7000000, 8500000, 9500000, BME280_SEA_LEVEL, 10400000 };
+
+#define ALT_TEST_GROUNDS (sizeof(alt_test_grounds) / sizeof(alt_test_grounds[0]))
+
+static uint32_t alt_test_pressures[ALT_TEST_SAMPLES];
+static volatile double alt_test_sink;
+
+
+static double alt_test_formula(uint32_t pressure, uint32_t ground)
+{
+        return 44330770.0 * (1.0 - pow((double)pressure / ground, 0.190263));
+}
+
+
+/**
+ * @brief Host cycles per conversion, for each of the three ways
+ *
+*/
+static void alt_test_cycles(const struct BME280_Ground *ground)
+{
+        uint64_t fixed;
+        uint64_t single;
+        uint64_t twice;
+        int32_t sum = 0;
+        float sum_f = 0;
+        double sum_d = 0;
+
+        fixed = host_cycles();
+        for (uint16_t r = 0; r < ALT_TEST_ROUNDS; r++)
+                for (uint16_t i = 0; i < ALT_TEST_SAMPLES; i++)
+                        sum += BME280_Altitude(ground, alt_test_pressures[i]);
+        fixed = host_cycles() - fixed;
+
+        single = host_cycles();
+        for (uint16_t r = 0; r < ALT_TEST_ROUNDS; r++)
+                for (uint16_t i = 0; i < ALT_TEST_SAMPLES; i++)
+                        sum_f += 44330.77f * (1.0f - powf((float)alt_test_pressures[i] / ground->pressure, 0.190263f));
+        single = host_cycles() - single;
+
+        twice = host_cycles();
+        for (uint16_t r = 0; r < ALT_TEST_ROUNDS; r++)
+                for (uint16_t i = 0; i < ALT_TEST_SAMPLES; i++)
+                        sum_d += alt_test_formula(alt_test_pressures[i], ground->pressure);
+        twice = host_cycles() - twice;
+
+        alt_test_sink = sum + sum_f + sum_d;
+
+        printf("host cycles per conversion: BME280_Altitude %.1f, powf %.1f, pow %.1f\n",
+               (double)fixed / (ALT_TEST_ROUNDS * ALT_TEST_SAMPLES),
+               (double)single / (ALT_TEST_ROUNDS * ALT_TEST_SAMPLES),
+               (double)twice / (ALT_TEST_ROUNDS * ALT_TEST_SAMPLES));
+}
+
+
+int main(void)
+{
+        struct BME280_Ground ground;
+        double max_error = 0;
+        int failed = 0;
+
+        for (uint8_t g = 0; g < ALT_TEST_GROUNDS; g++) {
+                double ground_max = 0;
+                double ground_sum = 0;
+                uint32_t count = 0;
+
+                BME280_SetGround(&ground, alt_test_grounds[g]);
+
+                for (uint32_t p = ALT_TEST_MIN; p <= ALT_TEST_MAX; p += ALT_TEST_STEP) {
+                        double error = fabs(BME280_Altitude(&ground, p) - alt_test_formula(p, alt_test_grounds[g]));
+
+                        if (error > ground_max)
+                                ground_max = error;
+                        ground_sum += error;
+                        count++;
+                }
+
+                printf("ground %7.2f hPa: %lu pressures, max error %.2f mm, mean %.2f mm\n",
+                       alt_test_grounds[g] / 10000.0, (unsigned long)count, ground_max, ground_sum / count);
+
+                if (ground_max > max_error)
+                        max_error = ground_max;
+        }
+
+        if (max_error > ALT_TEST_MAX_MM_ERROR)
+                failed = 1;
+
+        printf("max error %.2f mm (allowed %.1f mm): %s\n", max_error, ALT_TEST_MAX_MM_ERROR, failed ? "FAILED" : "OK");
+
+        for (uint16_t i = 0; i < ALT_TEST_SAMPLES; i++)
+                alt_test_pressures[i] = ALT_TEST_MIN + (uint32_t)(((uint64_t)(ALT_TEST_MAX - ALT_TEST_MIN) * i) / ALT_TEST_SAMPLES);
+
+        BME280_SetGround(&ground, BME280_SEA_LEVEL);
+        alt_test_cycles(&ground);
+
+        return failed;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "main.h"
+
+#include "bme280_lib.h"
+
+/**
+ * 32-bit compensation (bme280_comp.c) against the 64-bit one of the API (bme280.c)
+ *
+ * Usage: bme280_comp_test [calibration sets]
+ *
+ * Calibration sets are random within the spread of real sensors, raw values
+ *  random over the whole measuring range; per set COMP_TEST_READINGS readings
+ *  are compensated by both. Temperature and humidity must be the same, pressure
+ *  (where the API does not clamp it) within COMP_TEST_MAX_PA_ERROR.
+ *
+ * Exits with 1 if a reading is off
+ *
+*/
+
+#define COMP_TEST_DEFAULT_SETS 2000
+#define COMP_TEST_READINGS 200
+#define COMP_TEST_MAX_PA_ERROR 0.5 // [Pa] largest difference of pressure allowed (8 steps of 1/16 Pa)
+#define COMP_TEST_SEED 0x2545F491UL
+
+static uint32_t comp_test_state = COMP_TEST_SEED;
+
+
+/**
+ * @brief Random number in [min, min + span) (xorshift32, same sequence on every host)
+ *
+*/
+static int32_t comp_test_random(int32_t min, uint32_t span)
+{
+        comp_test_state ^= comp_test_state << 13;
+        comp_test_state ^= comp_test_state >> 17;
+        comp_test_state ^= comp_test_state << 5;
+
+        return min + (int32_t)(comp_test_state % span);
+}
+
+
+/**
+ * @brief Calibration data within the spread of real sensors (around datasheet example)
+ *
+*/
+static void comp_test_calib(struct bme280_calib_data *calib)
+{
+        calib->dig_t1 = (uint16_t)comp_test_random(27000, 2000);
+        calib->dig_t2 = (int16_t)comp_test_random(25000, 3000);
+        calib->dig_t3 = (int16_t)comp_test_random(-1050, 1100);
+
+        calib->dig_p1 = (uint16_t)comp_test_random(35000, 4000);
+        calib->dig_p2 = (int16_t)comp_test_random(-12000, 2000);
+        calib->dig_p3 = (int16_t)comp_test_random(2924, 200);
+        calib->dig_p4 = (int16_t)comp_test_random(2000, 8000);
+        calib->dig_p5 = (int16_t)comp_test_random(-200, 400);
+        calib->dig_p6 = (int16_t)comp_test_random(-9, 3);
+        calib->dig_p7 = (int16_t)comp_test_random(12500, 3000);
+        calib->dig_p8 = (int16_t)comp_test_random(-14600, 3000);
+        calib->dig_p9 = (int16_t)comp_test_random(4000, 2000);
+
+        calib->dig_h1 = (uint8_t)comp_test_random(60, 30);
+        calib->dig_h2 = (int16_t)comp_test_random(340, 50);
+        calib->dig_h3 = 0;
+        calib->dig_h4 = (int16_t)comp_test_random(290, 60);
+        calib->dig_h5 = (int16_t)comp_test_random(30, 40);
+        calib->dig_h6 = (int8_t)comp_test_random(20, 20);
+
+        calib->t_fine = 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+        long sets = (argc > 1) ? strtol(argv[1], NULL, 10) : COMP_TEST_DEFAULT_SETS;
+        uint32_t temperature_off = 0;
+        uint32_t humidity_off = 0;
+        uint32_t pressure_off = 0;
+        uint32_t compared = 0;
+        double max_error = 0;
+        double sum_error = 0;
+
+        for (long s = 0; s < sets; s++) {
+                struct bme280_calib_data calib;
+                struct BME280_Comp comp;
+
+                comp_test_calib(&calib);
+                BME280_CompInit(&comp, &calib);
+
+                for (uint16_t r = 0; r < COMP_TEST_READINGS; r++) {
+                        struct bme280_uncomp_data raw;
+                        struct bme280_data api;
+                        struct BME280_Result result;
+                        double error;
+
+                        raw.pressure = (uint32_t)comp_test_random(200000, 450000);
+                        raw.temperature = (uint32_t)comp_test_random(400000, 250000);
+                        raw.humidity = (uint32_t)comp_test_random(20000, 20000);
+
+                        bme280_compensate_data(BME280_ALL, &raw, &api, &calib);
+                        BME280_Compensate(&comp, BME280_ALL, &raw, &result);
+
+                        if (result.temperature != api.temperature)
+                                temperature_off++;
+                        if (result.humidity != api.humidity)
+                                humidity_off++;
+
+                        // clamped readings of both are the same limit
+                        if (api.pressure <= 3000000 || api.pressure >= 11000000)
+                                continue;
+
+                        error = ((double)result.pressure - (double)api.pressure) / 100;
+                        if (error < 0)
+                                error = -error;
+
+                        if (error > COMP_TEST_MAX_PA_ERROR)
+                                pressure_off++;
+                        if (error > max_error)
+                                max_error = error;
+
+                        sum_error += error;
+                        compared++;
+                }
+        }
+
+        printf("%ld calibration sets, %lu pressures compared: max error %.3f Pa, mean %.3f Pa\n",
+               sets, (unsigned long)compared, max_error, compared ? sum_error / compared : 0.0);
+        printf("temperature off %lu, humidity off %lu, pressure off by more than %.2f Pa %lu: %s\n",
+               (unsigned long)temperature_off, (unsigned long)humidity_off, COMP_TEST_MAX_PA_ERROR,
+               (unsigned long)pressure_off, (temperature_off || humidity_off || pressure_off || !compared) ? "FAILED" : "OK");
+
+        return (temperature_off || humidity_off || pressure_off || !compared);
+}
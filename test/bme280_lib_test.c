@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+
+#include "bme280_lib.h"
+
+/**
+ * Asynchronous (DMA) readings of bme280_lib.c with two sensors on one bus
+ *
+ * Usage: bme280_lib_test
+ *
+ * Sensors are simulated register files behind host_i2c_mem; the DMA reading ends when
+ *  the test calls host_i2c_complete(...) or when the interrupt armed in host_irq is taken
+ *  (at HAL calls and unmasking). The interrupt is moved over every such point of:
+ *      dispatch - the other sensor starts reading while the first one completes; each
+ *                 result must go to its own sensor, done called once
+ *      timeout  - the reading times out while it completes; it ends once, either way
+ *  then a bus with SDA held low and a failed transfer (error callback) are checked
+ *
+ * Exits with 1 if a check fails
+ *
+*/
+
+#define LIB_TEST_POINTS 8 // interrupt points tried in each sweep
+#define LIB_TEST_NONE -1.0 // pressure of a sensor whose reading did not complete
+
+#define LIB_TEST_CHECK(condition) lib_test_check((condition), #condition, __LINE__)
+
+/**
+ * Simulated sensor: registers and the ends of its asynchronous readings
+ *
+*/
+struct lib_test_sensor {
+        uint8_t regs[256];
+        uint8_t calls;
+        int8_t result;
+};
+
+BME280DeviceDef(a, BME280_I2C_ADDR_PRIM, BME280_OVERSAMPLING_1X, BME280_OVERSAMPLING_16X,
+                BME280_OVERSAMPLING_1X, BME280_FILTER_COEFF_16, BME280_STANDBY_TIME_0_5_MS);
+BME280DeviceDef(b, BME280_I2C_ADDR_SEC, BME280_OVERSAMPLING_1X, BME280_OVERSAMPLING_16X,
+                BME280_OVERSAMPLING_1X, BME280_FILTER_COEFF_16, BME280_STANDBY_TIME_0_5_MS);
+
+static I2C_HandleTypeDef hi2c1;
+static DMA_HandleTypeDef hdma_i2c1_rx;
+static struct lib_test_sensor sim_a;
+static struct lib_test_sensor sim_b;
+static uint8_t lib_test_nack; // DMA readings fail
+static uint8_t lib_test_skip; // interrupt points to let pass before the completion
+static int failed;
+
+
+static void lib_test_check(int condition, const char *text, int line)
+{
+        if (!condition) {
+                printf("line %d: check failed: %s\n", line, text);
+                failed = 1;
+        }
+}
+
+
+static struct lib_test_sensor *lib_test_sim(uint16_t address)
+{
+        return ((address >> 1) == BME280_I2C_ADDR_SEC) ? &sim_b : &sim_a;
+}
+
+
+/**
+ * @brief Memory access of the sensors; burst writes interleave register addresses (bme280_set_regs)
+ *
+*/
+static HAL_StatusTypeDef lib_test_mem(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg,
+                                      uint8_t *data, uint16_t size, uint8_t write)
+{
+        struct lib_test_sensor *sim = lib_test_sim(address);
+
+        if (hi2c != &hi2c1 || (address >> 1) < BME280_I2C_ADDR_PRIM || (address >> 1) > BME280_I2C_ADDR_SEC)
+                return HAL_ERROR;
+
+        if (!write) {
+                if (lib_test_nack && hi2c->State == HAL_I2C_STATE_BUSY_RX)
+                        return HAL_ERROR;
+
+                memcpy(data, sim->regs + reg, size);
+                return HAL_OK;
+        }
+
+        sim->regs[reg] = data[0];
+        for (uint16_t i = 1; i + 1 < size; i += 2)
+                sim->regs[data[i]] = data[i + 1];
+
+        // soft reset is done at once
+        sim->regs[BME280_RESET_ADDR] = 0;
+
+        return HAL_OK;
+}
+
+
+/**
+ * @brief Raw readings in the data registers
+ *
+*/
+static void lib_test_raw(struct lib_test_sensor *sim, uint32_t adc_p, uint32_t adc_t, uint16_t adc_h)
+{
+        uint8_t *regs = sim->regs;
+
+        regs[0xF7] = (uint8_t)(adc_p >> 12);
+        regs[0xF8] = (uint8_t)(adc_p >> 4);
+        regs[0xF9] = (uint8_t)(adc_p << 4);
+        regs[0xFA] = (uint8_t)(adc_t >> 12);
+        regs[0xFB] = (uint8_t)(adc_t >> 4);
+        regs[0xFC] = (uint8_t)(adc_t << 4);
+        regs[0xFD] = (uint8_t)(adc_h >> 8);
+        regs[0xFE] = (uint8_t)adc_h;
+}
+
+
+/**
+ * @brief Calibration of the datasheet example
+ *
+*/
+static void lib_test_load(struct lib_test_sensor *sim)
+{
+        static const int32_t calib[12] = {
+                27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000
+        };
+        uint8_t *regs = sim->regs;
+
+        memset(sim, 0, sizeof(*sim));
+        regs[BME280_CHIP_ID_ADDR] = BME280_CHIP_ID;
+
+        for (uint8_t i = 0; i < 12; i++) {
+                regs[0x88 + 2 * i] = (uint8_t)calib[i];
+                regs[0x89 + 2 * i] = (uint8_t)(calib[i] >> 8);
+        }
+
+        // dig_h1 .. dig_h6 (h4 = 313, h5 = 50)
+        regs[0xA1] = 75;
+        regs[0xE1] = 0x6A;
+        regs[0xE2] = 0x01;
+        regs[0xE3] = 0;
+        regs[0xE4] = 0x13;
+        regs[0xE5] = 0x29;
+        regs[0xE6] = 0x03;
+        regs[0xE7] = 30;
+}
+
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+        BME280_I2C_MemRxCpltCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+        BME280_I2C_ErrorCallback(hi2c);
+}
+
+
+static void lib_test_done(struct bme280_dev *sensor, int8_t result)
+{
+        struct lib_test_sensor *sim = (sensor == BME280Sensor(b)) ? &sim_b : &sim_a;
+
+        sim->calls++;
+        sim->result = result;
+}
+
+
+/**
+ * @brief Interrupt of the bus: DMA reading completes at the lib_test_skip-th point it can be taken
+ *
+*/
+static void lib_test_irq(void)
+{
+        if (lib_test_skip--) {
+                host_irq = lib_test_irq;
+                return ;
+        }
+
+        host_i2c_complete(&hi2c1);
+}
+
+
+/**
+ * @brief New readings of both sensors (data left in a context by another reading is stale)
+ *
+*/
+static void lib_test_clear(uint8_t point, double *ref_a, double *ref_b)
+{
+        host_irq = NULL;
+        sim_a.calls = sim_b.calls = 0;
+        sim_a.result = sim_b.result = BME280_OK;
+
+        lib_test_raw(&sim_a, 415148 + 1000UL * point, 519888, 30000);
+        lib_test_raw(&sim_b, 402000 + 1000UL * point, 530000, 28000);
+
+        LIB_TEST_CHECK(BME280_GetPressure(ref_a, BME280Sensor(a)) == BME280_OK);
+        LIB_TEST_CHECK(BME280_GetPressure(ref_b, BME280Sensor(b)) == BME280_OK);
+        LIB_TEST_CHECK(*ref_a != *ref_b);
+}
+
+
+/**
+ * @brief Sensor b starts reading while the one of sensor a completes at given point
+ *
+*/
+static void lib_test_dispatch(uint8_t point)
+{
+        double pressure_a = LIB_TEST_NONE;
+        double pressure_b = LIB_TEST_NONE;
+        double ref_a;
+        double ref_b;
+        int8_t started_b;
+
+        lib_test_clear(point, &ref_a, &ref_b);
+
+        LIB_TEST_CHECK(BME280_GetPressureAsync(&pressure_a, BME280Sensor(a), lib_test_done) == BME280_OK);
+        LIB_TEST_CHECK(BME280_GetPressureAsync(&pressure_a, BME280Sensor(a), lib_test_done) == BME280_W_BUSY);
+
+        lib_test_skip = point;
+        host_irq = lib_test_irq;
+        started_b = BME280_GetPressureAsync(&pressure_b, BME280Sensor(b), lib_test_done);
+        host_irq = NULL;
+
+        // interrupt not taken yet; b has not started, or started after a completed
+        host_i2c_complete(&hi2c1);
+
+        LIB_TEST_CHECK(started_b == BME280_OK || started_b == BME280_W_BUSY);
+        LIB_TEST_CHECK(sim_a.calls == 1 && sim_a.result == BME280_OK && pressure_a == ref_a);
+        LIB_TEST_CHECK(BME280_AsyncStatus(BME280Sensor(a)) == BME280_OK);
+
+        if (started_b == BME280_OK) {
+                host_i2c_complete(&hi2c1);
+                LIB_TEST_CHECK(sim_b.calls == 1 && sim_b.result == BME280_OK && pressure_b == ref_b);
+        }
+        else
+                LIB_TEST_CHECK(sim_b.calls == 0 && pressure_b == LIB_TEST_NONE);
+
+        LIB_TEST_CHECK(BME280_AsyncStatus(BME280Sensor(b)) == BME280_OK);
+        LIB_TEST_CHECK(hi2c1.State == HAL_I2C_STATE_READY);
+}
+
+
+/**
+ * @brief Reading of sensor a times out and completes at given point of BME280_AsyncStatus(...)
+ *
+*/
+static void lib_test_timeout(uint8_t point)
+{
+        double pressure_a = LIB_TEST_NONE;
+        double pressure_b = LIB_TEST_NONE;
+        double ref_a;
+        double ref_b;
+        int8_t status;
+
+        lib_test_clear(point, &ref_a, &ref_b);
+
+        LIB_TEST_CHECK(BME280_GetPressureAsync(&pressure_a, BME280Sensor(a), lib_test_done) == BME280_OK);
+        HAL_Delay(BME280_ASYNC_TIMEOUT + 1);
+
+        lib_test_skip = point;
+        host_irq = lib_test_irq;
+        status = BME280_AsyncStatus(BME280Sensor(a));
+        host_irq = NULL;
+
+        // completion after the bus is recovered is gone with the aborted DMA
+        host_i2c_complete(&hi2c1);
+
+        if (status == BME280_OK)
+                LIB_TEST_CHECK(sim_a.calls == 1 && sim_a.result == BME280_OK && pressure_a == ref_a);
+        else
+                LIB_TEST_CHECK(status == BME280_E_TIMEOUT && sim_a.calls == 1 && sim_a.result == BME280_E_TIMEOUT &&
+                               pressure_a == LIB_TEST_NONE);
+
+        LIB_TEST_CHECK(BME280_AsyncStatus(BME280Sensor(a)) == status);
+        LIB_TEST_CHECK(hi2c1.State == HAL_I2C_STATE_READY);
+
+        // bus is released
+        LIB_TEST_CHECK(BME280_GetPressureAsync(&pressure_b, BME280Sensor(b), lib_test_done) == BME280_OK);
+        host_i2c_complete(&hi2c1);
+        LIB_TEST_CHECK(sim_b.calls == 1 && pressure_b == ref_b);
+}
+
+
+int main(void)
+{
+        double ref_a;
+        double ref_b;
+        double pressure = LIB_TEST_NONE;
+
+        hi2c1.Instance = I2C1;
+        hi2c1.hdmarx = &hdma_i2c1_rx;
+        hdma_i2c1_rx.Parent = &hi2c1;
+        HAL_I2C_Init(&hi2c1);
+
+        host_i2c_mem = lib_test_mem;
+        lib_test_load(&sim_a);
+        lib_test_load(&sim_b);
+
+        // b is registered first, the callbacks must not find it before a
+        LIB_TEST_CHECK(BME280_Start(BME280(b), &hi2c1) == BME280_OK);
+        LIB_TEST_CHECK(BME280_Start(BME280(a), &hi2c1) == BME280_OK);
+
+        for (uint8_t point = 0; point < LIB_TEST_POINTS; point++)
+                lib_test_dispatch(point);
+
+        for (uint8_t point = 0; point < LIB_TEST_POINTS; point++)
+                lib_test_timeout(point);
+
+        // slave holds SDA low: bus is not recovered
+        lib_test_clear(0, &ref_a, &ref_b);
+        LIB_TEST_CHECK(BME280_GetPressureAsync(&pressure, BME280Sensor(a), lib_test_done) == BME280_OK);
+        HAL_Delay(BME280_ASYNC_TIMEOUT + 1);
+        host_gpio_low = GPIO_PIN_7;
+        LIB_TEST_CHECK(BME280_AsyncStatus(BME280Sensor(a)) == BME280_E_COMM_FAIL);
+        LIB_TEST_CHECK(sim_a.calls == 1 && sim_a.result == BME280_E_COMM_FAIL);
+        host_gpio_low = 0;
+
+        // transfer fails: error callback ends it
+        lib_test_clear(0, &ref_a, &ref_b);
+        lib_test_nack = 1;
+        LIB_TEST_CHECK(BME280_GetPressureAsync(&pressure, BME280Sensor(b), lib_test_done) == BME280_OK);
+        host_i2c_complete(&hi2c1);
+        LIB_TEST_CHECK(sim_b.calls == 1 && sim_b.result == BME280_E_COMM_FAIL);
+        LIB_TEST_CHECK(BME280_AsyncStatus(BME280Sensor(b)) == BME280_E_COMM_FAIL);
+        lib_test_nack = 0;
+
+        LIB_TEST_CHECK(BME280_GetPressureAsync(&pressure, BME280Sensor(a), lib_test_done) == BME280_OK);
+        host_i2c_complete(&hi2c1);
+        LIB_TEST_CHECK(pressure == ref_a);
+
+        printf("async readings: %.2f Pa and %.2f Pa on one bus, %u interrupt points: %s\n",
+               ref_a, ref_b, LIB_TEST_POINTS, failed ? "FAILED" : "OK");
+
+        return failed;
+}
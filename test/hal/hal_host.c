@@ -0,0 +1,322 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "main.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Same address as on STM32F103C8 (see GPS_WARM_FLASH_ADDR), mapped with mmap by host_flash_init
+#define HOST_FLASH_BASE 0x0800F000UL
+#define HOST_FLASH_SIZE 0x1000UL
+
+CoreDebug_Type host_core_debug;
+void (*host_uart_tx)(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+void (*host_irq)(void);
+uint32_t host_primask;
+
+GPIO_TypeDef host_gpiob;
+AFIO_TypeDef host_afio;
+I2C_TypeDef host_i2c1, host_i2c2;
+HAL_StatusTypeDef (*host_i2c_mem)(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg, 
+                                  uint8_t *data, uint16_t size, uint8_t write);
+uint16_t host_gpio_low;
+
+static DWT_Type host_dwt_regs;
+static uint32_t host_delay_ms;
+
+
+/**
+ * @brief Cycles of the host CPU (time stamp counter on x86, nanoseconds elsewhere)
+ * 
+*/
+uint64_t host_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+
+/**
+ * @brief DWT registers; CYCCNT holds the host cycle counter at every access
+ * 
+*/
+DWT_Type *host_dwt(void)
+{
+        host_dwt_regs.CYCCNT = (uint32_t)host_cycles();
+
+        return &host_dwt_regs;
+}
+
+
+/**
+ * @brief Map erased flash page(s) at the address used on the target
+ * 
+ * @retval 0 on success, -1 if the address range is taken on this host
+*/
+int host_flash_init(void)
+{
+        void *page = mmap((void *)HOST_FLASH_BASE, HOST_FLASH_SIZE, PROT_READ | PROT_WRITE, 
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+        if (page != (void *)HOST_FLASH_BASE)
+                return -1;
+
+        memset(page, 0xFF, HOST_FLASH_SIZE);
+
+        return 0;
+}
+
+
+/**
+ * @brief Take the waiting interrupt (host_irq) unless interrupts are masked
+ * 
+*/
+void host_irq_take(void)
+{
+        void (*irq)(void) = host_irq;
+
+        if (irq == NULL || host_primask)
+                return ;
+
+        host_irq = NULL;
+        irq();
+}
+
+
+/**
+ * @brief Milliseconds since start; HAL_Delay(...) moves it forward without sleeping
+ * 
+*/
+uint32_t HAL_GetTick(void)
+{
+        struct timespec now;
+
+        host_irq_take();
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000) + host_delay_ms;
+}
+
+void HAL_Delay(uint32_t delay)
+{
+        host_delay_ms += delay;
+}
+
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+        huart->RxState = HAL_UART_STATE_READY;
+
+        return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout)
+{
+        (void)timeout;
+
+        if (host_uart_tx != NULL)
+                host_uart_tx(huart, data, size);
+
+        return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size)
+{
+        (void)data;
+        (void)size;
+        huart->RxState = HAL_UART_STATE_BUSY_RX;
+
+        return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size)
+{
+        return HAL_UART_Receive_IT(huart, data, size);
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+        huart->RxState = HAL_UART_STATE_READY;
+
+        return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+        return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+        return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *erase, uint32_t *page_error)
+{
+        if (erase->PageAddress < HOST_FLASH_BASE || 
+            erase->PageAddress + erase->NbPages * FLASH_PAGE_SIZE > HOST_FLASH_BASE + HOST_FLASH_SIZE)
+                return HAL_ERROR;
+
+        memset((void *)(uintptr_t)erase->PageAddress, 0xFF, erase->NbPages * FLASH_PAGE_SIZE);
+        *page_error = 0xFFFFFFFFU;
+
+        return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t address, uint64_t data)
+{
+        uint32_t word = (uint32_t)data;
+        uint32_t *target = (uint32_t *)(uintptr_t)address;
+
+        if (type != FLASH_TYPEPROGRAM_WORD || address < HOST_FLASH_BASE || 
+            address + 4 > HOST_FLASH_BASE + HOST_FLASH_SIZE)
+                return HAL_ERROR;
+
+        // flash bits can only be cleared by programming
+        if (*target != 0xFFFFFFFFU)
+                return HAL_ERROR;
+
+        *target = word;
+
+        return HAL_OK;
+}
+
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init)
+{
+        (void)port;
+        (void)init;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+        if (state == GPIO_PIN_SET)
+                port->ODR |= pin;
+        else
+                port->ODR &= ~(uint32_t)pin;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin)
+{
+        // open drain: low if driven low or held low by a slave
+        if (!(port->ODR & pin) || (port == GPIOB && (host_gpio_low & pin)))
+                return GPIO_PIN_RESET;
+
+        return GPIO_PIN_SET;
+}
+
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+        I2C_HandleTypeDef *hi2c = hdma->Parent;
+
+        if (hi2c != NULL)
+                hi2c->pBuffPtr = NULL;
+
+        return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+        hi2c->State = HAL_I2C_STATE_READY;
+
+        return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+        hi2c->State = HAL_I2C_STATE_RESET;
+
+        return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg, uint16_t reg_size, 
+                                    uint8_t *data, uint16_t size, uint32_t timeout)
+{
+        (void)reg_size;
+        (void)timeout;
+        host_irq_take();
+
+        if (hi2c->State != HAL_I2C_STATE_READY)
+                return HAL_BUSY;
+
+        return (host_i2c_mem != NULL) ? host_i2c_mem(hi2c, address, reg, data, size, 1) : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg, uint16_t reg_size, 
+                                   uint8_t *data, uint16_t size, uint32_t timeout)
+{
+        (void)reg_size;
+        (void)timeout;
+        host_irq_take();
+
+        if (hi2c->State != HAL_I2C_STATE_READY)
+                return HAL_BUSY;
+
+        return (host_i2c_mem != NULL) ? host_i2c_mem(hi2c, address, reg, data, size, 0) : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg, uint16_t reg_size, 
+                                       uint8_t *data, uint16_t size)
+{
+        (void)reg_size;
+        host_irq_take();
+
+        if (hi2c->State != HAL_I2C_STATE_READY)
+                return HAL_BUSY;
+
+        hi2c->State = HAL_I2C_STATE_BUSY_RX;
+        hi2c->pBuffPtr = data;
+        hi2c->XferSize = size;
+        hi2c->Devaddress = address;
+        hi2c->Memaddress = reg;
+
+        return HAL_OK;
+}
+
+
+/**
+ * @brief End DMA reading in progress on the bus (nothing if it was aborted or none was started)
+ * 
+*/
+void host_i2c_complete(I2C_HandleTypeDef *hi2c)
+{
+        uint8_t *data = hi2c->pBuffPtr;
+        HAL_StatusTypeDef status;
+
+        if (data == NULL || hi2c->State != HAL_I2C_STATE_BUSY_RX)
+                return ;
+
+        // State is still HAL_I2C_STATE_BUSY_RX for the slave
+        status = (host_i2c_mem != NULL) ? 
+                 host_i2c_mem(hi2c, (uint16_t)hi2c->Devaddress, (uint16_t)hi2c->Memaddress, data, hi2c->XferSize, 0) : HAL_ERROR;
+
+        hi2c->pBuffPtr = NULL;
+        hi2c->State = HAL_I2C_STATE_READY;
+
+        if (status == HAL_OK)
+                HAL_I2C_MemRxCpltCallback(hi2c);
+        else
+                HAL_I2C_ErrorCallback(hi2c);
+}
+
+// weak like those of HAL, the application routes them to the libraries
+__attribute__((weak)) void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+        (void)hi2c;
+}
+
+__attribute__((weak)) void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+        (void)hi2c;
+}
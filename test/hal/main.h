@@ -0,0 +1,217 @@
+#ifndef MAIN_H
+#define MAIN_H
+
+/**
+ * Stand-in of the CubeMX main.h for host builds (see test/Makefile)
+ * 
+ * Declares only the HAL types, functions and CMSIS intrinsics used by libs/NEO6 
+ *  and libs/BME280; they are implemented in hal_host.c
+ * 
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+        HAL_OK = 0x00U,
+        HAL_ERROR = 0x01U,
+        HAL_BUSY = 0x02U,
+        HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay);
+
+// ****************************************************
+//          CMSIS                                     *
+// ****************************************************
+
+#define __DMB() __sync_synchronize()
+
+// interrupts of the host are simulated (host_irq); one waiting is taken once unmasked
+extern uint32_t host_primask;
+void host_irq_take(void);
+
+static inline uint32_t __get_PRIMASK(void) { return host_primask; }
+static inline void __set_PRIMASK(uint32_t primask) { host_primask = primask; host_irq_take(); }
+static inline void __disable_irq(void) { host_primask = 1; }
+static inline void __enable_irq(void) { host_primask = 0; host_irq_take(); }
+
+// DWT cycle counter reads the host cycle counter, see host_cycles()
+typedef struct {
+        volatile uint32_t CTRL;
+        volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+        volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+DWT_Type *host_dwt(void);
+extern CoreDebug_Type host_core_debug;
+
+#define DWT (host_dwt())
+#define CoreDebug (&host_core_debug)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+
+// ****************************************************
+//          UART                                      *
+// ****************************************************
+
+typedef enum {
+        HAL_UART_STATE_RESET = 0x00U,
+        HAL_UART_STATE_READY = 0x20U,
+        HAL_UART_STATE_BUSY_RX = 0x22U
+} HAL_UART_StateTypeDef;
+
+typedef struct {
+        uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct {
+        void *Instance;
+        UART_InitTypeDef Init;
+        HAL_UART_StateTypeDef RxState;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+
+// ****************************************************
+//          GPIO, DMA, I2C (bus of bme280_lib.c)      *
+// ****************************************************
+
+typedef struct {
+        uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+        GPIO_PIN_RESET = 0,
+        GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+        uint32_t Pin;
+        uint32_t Mode;
+        uint32_t Pull;
+        uint32_t Speed;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_6 0x0040U
+#define GPIO_PIN_7 0x0080U
+#define GPIO_PIN_8 0x0100U
+#define GPIO_PIN_9 0x0200U
+#define GPIO_PIN_10 0x0400U
+#define GPIO_PIN_11 0x0800U
+#define GPIO_MODE_OUTPUT_OD 0x11U
+#define GPIO_SPEED_FREQ_LOW 0x02U
+
+extern GPIO_TypeDef host_gpiob;
+#define GPIOB (&host_gpiob)
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+
+typedef struct {
+        uint32_t MAPR;
+} AFIO_TypeDef;
+
+extern AFIO_TypeDef host_afio;
+#define AFIO (&host_afio)
+#define AFIO_MAPR_I2C1_REMAP (1UL << 1)
+
+typedef struct {
+        void *Parent; // I2C handle of the stream
+} DMA_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+
+typedef struct {
+        uint32_t CR1;
+} I2C_TypeDef;
+
+extern I2C_TypeDef host_i2c1, host_i2c2;
+#define I2C1 (&host_i2c1)
+#define I2C2 (&host_i2c2)
+
+typedef enum {
+        HAL_I2C_STATE_RESET = 0x00U,
+        HAL_I2C_STATE_READY = 0x20U,
+        HAL_I2C_STATE_BUSY_RX = 0x22U
+} HAL_I2C_StateTypeDef;
+
+// transfer fields hold the DMA reading in progress until host_i2c_complete(...)
+typedef struct {
+        I2C_TypeDef *Instance;
+        DMA_HandleTypeDef *hdmarx;
+        volatile HAL_I2C_StateTypeDef State;
+        uint8_t *pBuffPtr;
+        uint16_t XferSize;
+        uint32_t Devaddress;
+        uint32_t Memaddress;
+} I2C_HandleTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT 0x01U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg, uint16_t reg_size, 
+                                    uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg, uint16_t reg_size, 
+                                   uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg, uint16_t reg_size, 
+                                       uint8_t *data, uint16_t size);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+// ****************************************************
+//          Flash (page at GPS_WARM_FLASH_ADDR is mapped by host_flash_init)
+// ****************************************************
+
+typedef struct {
+        uint32_t TypeErase;
+        uint32_t Banks;
+        uint32_t PageAddress;
+        uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+#define FLASH_TYPEERASE_PAGES 0x00U
+#define FLASH_TYPEPROGRAM_WORD 0x02U
+#define FLASH_PAGE_SIZE 0x400U
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *erase, uint32_t *page_error);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t address, uint64_t data);
+
+// ****************************************************
+//          Host helpers (hal_host.c)                 *
+// ****************************************************
+
+uint64_t host_cycles(void);
+int host_flash_init(void);
+
+// Called with every frame sent by HAL_UART_Transmit(...), e.g. by a simulated receiver; may be NULL
+extern void (*host_uart_tx)(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+
+// Interrupt waiting to be taken, once, by HAL_GetTick(), HAL_I2C_* or unmasking; may be NULL
+extern void (*host_irq)(void);
+
+// Memory access of simulated I2C slaves (address is 8-bit, as given to HAL); NULL if there are none
+extern HAL_StatusTypeDef (*host_i2c_mem)(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t reg, 
+                                         uint8_t *data, uint16_t size, uint8_t write);
+
+// Pins of GPIOB held low by a slave (e.g. SDA of a stuck bus)
+extern uint16_t host_gpio_low;
+
+// End DMA reading in progress on the bus as its interrupt does (HAL_I2C_MemRxCpltCallback or ErrorCallback)
+void host_i2c_complete(I2C_HandleTypeDef *hi2c);
+
+#endif
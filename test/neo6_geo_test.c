@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "main.h"
+
+#include "neo6.h"
+
+/**
+ * Fixed-point geodesy (neo6_geo.c) against double precision WGS84 over the flight envelope
+ *
+ * Usage: neo6_geo_test
+ *
+ * Reference points every GEO_TEST_LAT_STEP degrees of latitude within GEO_TEST_MAX_LAT
+ *  (at several longitudes, antimeridian included); targets around each on rings of
+ *  geo_test_radii at GEO_TEST_BEARINGS bearings. Reference east and north are those of the
+ *  target in the tangent plane at the reference point (geodetic -> ECEF -> ENU, both on
+ *  the ellipsoid, as neo6_geo.c uses degree lengths at sea level); up is the altitude
+ *  difference. Errors of NEO6_GeoToENU(...), NEO6_GeoDistance(...) and NEO6_GeoBearing(...)
+ *  must stay within the limits of the ring.
+ *
+ * Exits with 1 if an error is larger
+ *
+*/
+
+#define GEO_TEST_MAX_LAT 70 // [degrees] flight envelope, launch sites within
+#define GEO_TEST_LAT_STEP 5 // [degrees]
+#define GEO_TEST_BEARINGS 36 // targets per ring
+#define GEO_TEST_ALT 1500000 // [mm] altitude of the targets above the reference
+
+#define GEO_TEST_PI 3.14159265358979323846
+#define WGS84_A 6378137.0
+#define WGS84_F (1 / 298.257223563)
+
+/**
+ * Ring of targets and largest errors allowed on it
+ *
+*/
+struct geo_test_ring {
+        double radius; // [m]
+        double max_offset; // [m] east and north
+        double max_distance; // [m]
+        double max_bearing; // [degrees]
+};
+
+static const struct geo_test_ring geo_test_radii[] = {
+        { 10.0, 0.005, 0.005, 0.1 }, // mm resolution of the offsets
+        { 100.0, 0.01, 0.01, 0.05 },
+        { 1000.0, 0.02, 0.02, 0.05 },
+        { 5000.0, 0.1, 0.1, 0.05 },
+        { 10000.0, 0.25, 0.25, 0.05 },
+};
+
+static const double geo_test_lons[] = { 0.0, 17.25, -122.5, 179.99, -179.99 };
+
+#define GEO_TEST_RINGS (sizeof(geo_test_radii) / sizeof(geo_test_radii[0]))
+#define GEO_TEST_LONS (sizeof(geo_test_lons) / sizeof(geo_test_lons[0]))
+
+struct geo_test_error {
+        double offset;
+        double distance;
+        double bearing;
+        uint32_t up_off;
+};
+
+
+/**
+ * @brief ECEF coordinates of point on the WGS84 ellipsoid
+ *
+*/
+static void geo_test_ecef(double lat, double lon, double ecef[3])
+{
+        double e2 = WGS84_F * (2 - WGS84_F);
+        double n = WGS84_A / sqrt(1 - e2 * sin(lat) * sin(lat));
+
+        ecef[0] = n * cos(lat) * cos(lon);
+        ecef[1] = n * cos(lat) * sin(lon);
+        ecef[2] = n * (1 - e2) * sin(lat);
+}
+
+
+/**
+ * @brief East and north of the target in the tangent plane at the reference [m]
+ *
+*/
+static void geo_test_enu(double ref_lat, double ref_lon, double lat, double lon, double *east, double *north)
+{
+        double ref[3];
+        double target[3];
+        double d[3];
+
+        geo_test_ecef(ref_lat, ref_lon, ref);
+        geo_test_ecef(lat, lon, target);
+
+        for (uint8_t i = 0; i < 3; i++)
+                d[i] = target[i] - ref[i];
+
+        *east = -sin(ref_lon) * d[0] + cos(ref_lon) * d[1];
+        *north = -sin(ref_lat) * cos(ref_lon) * d[0] - sin(ref_lat) * sin(ref_lon) * d[1] + cos(ref_lat) * d[2];
+}
+
+
+static void geo_test_position(struct position_data *pos, double lat, double lon, int32_t alt)
+{
+        int32_t lat_e7 = (int32_t)lround(lat * GPS_COORD_SCALE);
+        int32_t lon_e7;
+
+        if (lon > 180)
+                lon -= 360;
+        else if (lon < -180)
+                lon += 360;
+
+        lon_e7 = (int32_t)lround(lon * GPS_COORD_SCALE);
+
+        pos->lat = labs(lat_e7);
+        pos->lat_dir = (lat_e7 < 0) ? 'S' : 'N';
+        pos->lon = labs(lon_e7);
+        pos->lon_dir = (lon_e7 < 0) ? 'W' : 'E';
+        pos->alt = alt;
+}
+
+
+static void geo_test_max(double *max, double value)
+{
+        if (value > *max)
+                *max = value;
+}
+
+
+/**
+ * @brief Largest errors on one ring, for every reference point
+ *
+*/
+static void geo_test_ring(const struct geo_test_ring *ring, struct geo_test_error *max)
+{
+        for (int32_t ref_lat = -GEO_TEST_MAX_LAT; ref_lat <= GEO_TEST_MAX_LAT; ref_lat += GEO_TEST_LAT_STEP) {
+                for (uint8_t l = 0; l < GEO_TEST_LONS; l++) {
+                        struct position_data origin;
+                        struct NEO6_GeoRef ref;
+                        // reference is the position actually stored (1e-7 degrees)
+                        double lat0;
+                        double lon0;
+
+                        geo_test_position(&origin, ref_lat + 0.123456, geo_test_lons[l], 250000);
+                        NEO6_GeoSetRef(&ref, &origin);
+                        lat0 = ref.lat / (double)GPS_COORD_SCALE;
+                        lon0 = ref.lon / (double)GPS_COORD_SCALE;
+
+                        for (uint16_t b = 0; b < GEO_TEST_BEARINGS; b++) {
+                                double angle = (360.0 * b / GEO_TEST_BEARINGS + 3.3) * GEO_TEST_PI / 180;
+                                struct position_data target;
+                                struct NEO6_ENU enu;
+                                double lat, lon, east, north, bearing, diff;
+
+                                // approximate ring on the sphere; reference ENU is computed for the stored target
+                                lat = lat0 + ring->radius * cos(angle) / 111195.0;
+                                lon = lon0 + ring->radius * sin(angle) / (111195.0 * cos(lat0 * GEO_TEST_PI / 180));
+                                geo_test_position(&target, lat, lon, origin.alt + GEO_TEST_ALT);
+
+                                lat = ((target.lat_dir == 'S') ? -(double)target.lat : target.lat) / GPS_COORD_SCALE;
+                                lon = ((target.lon_dir == 'W') ? -(double)target.lon : target.lon) / GPS_COORD_SCALE;
+                                geo_test_enu(lat0 * GEO_TEST_PI / 180, lon0 * GEO_TEST_PI / 180, lat * GEO_TEST_PI / 180, lon * GEO_TEST_PI / 180, &east, &north);
+
+                                NEO6_GeoToENU(&ref, &target, &enu);
+
+                                geo_test_max(&max->offset, fabs(enu.east / 1000.0 - east));
+                                geo_test_max(&max->offset, fabs(enu.north / 1000.0 - north));
+                                geo_test_max(&max->distance, fabs(NEO6_GeoDistance(&enu) / 1000.0 - hypot(east, north)));
+
+                                if (enu.up != GEO_TEST_ALT)
+                                        max->up_off++;
+
+                                bearing = atan2(east, north) * 180 / GEO_TEST_PI;
+                                diff = fabs(NEO6_GeoBearing(&enu) / 100.0 - ((bearing < 0) ? bearing + 360 : bearing));
+                                geo_test_max(&max->bearing, (diff > 180) ? 360 - diff : diff);
+                        }
+                }
+        }
+}
+
+
+int main(void)
+{
+        int failed = 0;
+
+        for (uint8_t r = 0; r < GEO_TEST_RINGS; r++) {
+                const struct geo_test_ring *ring = &geo_test_radii[r];
+                struct geo_test_error max = { 0, 0, 0, 0 };
+                int ring_failed;
+
+                geo_test_ring(ring, &max);
+
+                ring_failed = (max.offset > ring->max_offset || max.distance > ring->max_distance ||
+                               max.bearing > ring->max_bearing || max.up_off);
+
+                printf("%7.0f m: max error east/north %.3f m (%.3f), distance %.3f m (%.3f), bearing %.3f deg (%.2f), up off %lu: %s\n",
+                       ring->radius, max.offset, ring->max_offset, max.distance, ring->max_distance,
+                       max.bearing, ring->max_bearing, (unsigned long)max.up_off, ring_failed ? "FAILED" : "OK");
+
+                if (ring_failed)
+                        failed = 1;
+        }
+
+        return failed;
+}
@@ -0,0 +1,585 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "main.h"
+
+#include "neo6.h"
+
+/**
+ * Replay of a recorded NMEA log through the receive path of the NEO6 library
+ *
+ * Usage: neo6_replay [log] [passes]
+ *
+ * Every reception mode of the library gets the whole log byte by byte the way
+ *  the UART (or its DMA) delivers it; per mode it reports:
+ *      sentences/s     - accepted sentences per second of host time
+ *      cycles/sentence - host cycles of the receive path per received sentence
+ *      calc cycles     - min/avg/max cycles of storing one sentence (GPS_USE_DWT, NEO6_GetHealth)
+ *      fix latency     - from the '$' of the first sentence of an epoch until NEO6_GetFix(...)
+ *                        returns its fix, in host cycles and in ms of the bytes on the wire
+ *
+ * Then NEO6_ReceiveBuffer(...) gets the log char by char (path of every char before
+ *  NMEA_ParseRun(...)) and in blocks of REPLAY_BLOCK chars (fields taken 4 at a time by
+ *  NMEA_ParseRun(...)); sentences/s of both and the speedup are reported
+ *
+ * DMA modes get the log once more with a UART error in the middle of it (reception
+ *  restarted at the beginning of the DMA buffer); both must count the same sentences
+ *  and the fix time must not go back (no message of the previous DMA lap parsed again)
+ *
+ * UBX protocol gets one navigation epoch (NAV-POSLLH, NAV-SOL, NAV-VELNED); speed and
+ *  course of the fix and velocity of the predictor must come from NAV-VELNED
+ *
+ * Exits with 1 if a mode counts other sentences or ends with other info than the first one, or without fix
+ *
+*/
+
+#define REPLAY_DEFAULT_LOG "data/flight.nmea"
+#define REPLAY_DEFAULT_PASSES 200
+#define REPLAY_BAUDRATE 9600 // default baudrate of NEO-6, for wire time of fix latency
+#define REPLAY_TASK_BATCH 16 // chars stored by interrupts before the parsing task runs
+#define REPLAY_MAX_EPOCHS 4096
+#define REPLAY_BLOCK GPS_DMA_BUFFER_SIZE // chars per NEO6_ReceiveBuffer(...) call in block benchmark
+#define REPLAY_REPEAT 15 // runs of block benchmark, median is reported
+#define REPLAY_ERROR_POS 100 // DMA position of the UART error, with complete messages of the previous lap after it
+#define REPLAY_UBX_ITOW 345600000UL // GPS time of week of the UBX epoch [ms]
+#define REPLAY_UBX_SPEED 1234 // ground speed of the UBX epoch [cm/s]
+#define REPLAY_UBX_HEADING 4500000L // heading of motion of the UBX epoch [1e-5 degrees]
+
+struct replay_log {
+        char *data;
+        uint32_t len;
+
+        /**
+         * Offset of the first sentence with fix of each epoch and its time of day (s)
+         *
+        */
+        uint32_t epoch_offset[REPLAY_MAX_EPOCHS];
+        uint32_t epoch_time[REPLAY_MAX_EPOCHS];
+        uint16_t epochs;
+};
+
+struct replay_mode {
+        const char *name;
+        uint8_t rx_mode;
+        uint8_t parse_mode;
+};
+
+struct replay_latency {
+        uint32_t fixes;
+        uint64_t cycles_min;
+        uint64_t cycles_max;
+        uint64_t cycles_total;
+        uint64_t bytes_total;
+
+        /**
+         * Host cycles at the start of each epoch of the log
+         *
+        */
+        uint64_t start[REPLAY_MAX_EPOCHS];
+        uint16_t next_epoch;
+        uint32_t last_time;
+        uint16_t last_ms;
+        uint32_t last_seq;
+};
+
+static const struct replay_mode replay_modes[] = {
+        { "uart-it", GPS_RX_MODE_IT, GPS_PARSE_IN_ISR },
+        { "uart-it-task", GPS_RX_MODE_IT, GPS_PARSE_IN_TASK },
+        { "uart-dma", GPS_RX_MODE_DMA, GPS_PARSE_IN_ISR },
+        { "uart-dma-task", GPS_RX_MODE_DMA, GPS_PARSE_IN_TASK },
+};
+
+#define REPLAY_MODES (sizeof(replay_modes) / sizeof(replay_modes[0]))
+
+static struct NEO6 gps;
+static UART_HandleTypeDef huart;
+static uint16_t dma_pos;
+
+
+/**
+ * @brief Read whole log and find the first sentence with fix (GGA, RMC) of each epoch
+ *
+*/
+static int replay_load(struct replay_log *log, const char *path)
+{
+        FILE *file = fopen(path, "rb");
+        long size;
+
+        if (file == NULL)
+                return -1;
+
+        fseek(file, 0, SEEK_END);
+        size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        log->data = malloc(size > 0 ? size : 1);
+        log->len = (uint32_t)fread(log->data, 1, size, file);
+        log->epochs = 0;
+        fclose(file);
+
+        for (uint32_t i = 0; i + 18 < log->len; i++) {
+                const char *s = log->data + i;
+                uint32_t time;
+                uint8_t fix;
+
+                if (s[0] != '$' || (strncmp(s + 3, "GGA,", 4) && strncmp(s + 3, "RMC,", 4)))
+                        continue;
+
+                if (s[7] < '0' || s[7] > '9')
+                        continue;
+
+                time = ((s[7] - '0') * 10 + (s[8] - '0')) * 3600 + ((s[9] - '0') * 10 + (s[10] - '0')) * 60 +
+                       (s[11] - '0') * 10 + (s[12] - '0');
+
+                // GGA: quality after 5 fields, RMC: status right after time
+                if (s[4] == 'G') {
+                        const char *field = s;
+
+                        for (uint8_t commas = 0; commas < 6 && field != NULL; commas++)
+                                field = strchr(field + 1, ',');
+                        fix = (field != NULL && field[1] >= '1' && field[1] <= '9');
+                }
+                else
+                        fix = (strchr(s + 7, ',')[1] == 'A');
+
+                if (!fix || (log->epochs && log->epoch_time[log->epochs - 1] == time))
+                        continue;
+
+                if (log->epochs < REPLAY_MAX_EPOCHS) {
+                        log->epoch_offset[log->epochs] = i;
+                        log->epoch_time[log->epochs] = time;
+                        log->epochs++;
+                }
+        }
+
+        return 0;
+}
+
+
+/**
+ * @brief Initialize the library in given mode, as with UART on the target
+ *
+*/
+static void replay_init(const struct replay_mode *mode)
+{
+        memset(&gps, 0, sizeof(gps));
+        memset(&huart, 0, sizeof(huart));
+        huart.Init.BaudRate = REPLAY_BAUDRATE;
+        dma_pos = 0;
+
+        if (mode->rx_mode == GPS_RX_MODE_DMA)
+                NEO6_InitDMA(&gps, &huart);
+        else
+                NEO6_Init(&gps, &huart);
+
+        NEO6_SetParseMode(&gps, mode->parse_mode);
+}
+
+
+/**
+ * @brief Deliver one received char the way the HAL does in the mode
+ *
+ * IT: HAL_UART_RxCpltCallback per char; DMA: circular buffer with half transfer,
+ *  transfer complete and idle line events (idle after each line)
+ *
+*/
+static void replay_char(const struct replay_mode *mode, char c, uint32_t received)
+{
+        if (mode->rx_mode == GPS_RX_MODE_IT) {
+                gps.com.rx_char = (uint8_t)c;
+                NEO6_UART_RxCpltCallback(&huart);
+        }
+        else {
+                gps.com.dma_buffer[dma_pos++] = (uint8_t)c;
+
+                if (dma_pos == GPS_DMA_BUFFER_SIZE / 2 || dma_pos == GPS_DMA_BUFFER_SIZE || c == '\n')
+                        NEO6_UART_RxEventCallback(&huart, dma_pos);
+
+                if (dma_pos == GPS_DMA_BUFFER_SIZE)
+                        dma_pos = 0;
+        }
+
+        // parsing task wakes up after a few notifications
+        if (mode->parse_mode == GPS_PARSE_IN_TASK && (received % REPLAY_TASK_BATCH) == 0)
+                NEO6_Process(&gps);
+}
+
+
+/**
+ * @brief Feed the whole log; parsing task (if any) runs at the end as well
+ *
+*/
+static void replay_pass(const struct replay_mode *mode, const struct replay_log *log)
+{
+        for (uint32_t i = 0; i < log->len; i++)
+                replay_char(mode, log->data[i], i + 1);
+
+        if (mode->parse_mode == GPS_PARSE_IN_TASK)
+                NEO6_Process(&gps);
+}
+
+
+/**
+ * @brief Check for new fix after a char; sample its latency
+ *
+*/
+static void replay_latency_check(struct replay_latency *lat, const struct replay_log *log, uint32_t received)
+{
+        struct NEO6_Fix fix;
+        uint64_t now = host_cycles();
+
+        if (gps.seq == lat->last_seq)
+                return ;
+        lat->last_seq = gps.seq;
+
+        if (NEO6_GetFix(&gps, &fix) != GPS_OK || !fix.info.quality)
+                return ;
+
+        if (fix.info.utc_time == lat->last_time && fix.info.utc_ms == lat->last_ms)
+                return ;
+        lat->last_time = fix.info.utc_time;
+        lat->last_ms = fix.info.utc_ms;
+
+        for (uint16_t e = 0; e < lat->next_epoch; e++) {
+                if (log->epoch_time[e] == fix.info.utc_time % 86400) {
+                        uint64_t cycles = now - lat->start[e];
+
+                        if (!lat->fixes || cycles < lat->cycles_min)
+                                lat->cycles_min = cycles;
+                        if (cycles > lat->cycles_max)
+                                lat->cycles_max = cycles;
+
+                        lat->cycles_total += cycles;
+                        lat->bytes_total += received - log->epoch_offset[e];
+                        lat->fixes++;
+                        break;
+                }
+        }
+}
+
+
+/**
+ * @brief Feed the log once more, checking for new fix after every char
+ *
+*/
+static void replay_latency(const struct replay_mode *mode, const struct replay_log *log, struct replay_latency *lat)
+{
+        memset(lat, 0, sizeof(*lat));
+        lat->last_seq = gps.seq;
+
+        for (uint32_t i = 0; i < log->len; i++) {
+                if (lat->next_epoch < log->epochs && log->epoch_offset[lat->next_epoch] == i)
+                        lat->start[lat->next_epoch++] = host_cycles();
+
+                replay_char(mode, log->data[i], i + 1);
+                replay_latency_check(lat, log, i + 1);
+        }
+}
+
+
+/**
+ * @brief Feed the log with UART error in the middle of it (DMA modes); the char at the 
+ * 	  error is lost and DMA starts again at the beginning of the buffer
+ *
+ * @retval 1 if the fix time went back, 0 otherwise
+*/
+static int replay_error(const struct replay_mode *mode, const struct replay_log *log)
+{
+        uint32_t error_at = log->len / 2;
+        uint64_t last_time = 0;
+        int back = 0;
+
+        replay_init(mode);
+
+        for (uint32_t i = 0; i < log->len; i++) {
+                uint64_t time;
+
+                if (i >= error_at && error_at && dma_pos == REPLAY_ERROR_POS) {
+                        NEO6_UART_ErrorCallback(&huart);
+                        dma_pos = 0;
+                        error_at = 0;
+                        continue;
+                }
+
+                replay_char(mode, log->data[i], i + 1);
+
+                time = (uint64_t)gps.info.utc_time * 1000 + gps.info.utc_ms;
+                if (gps.info.quality && time < last_time)
+                        back = 1;
+                if (gps.info.quality)
+                        last_time = time;
+        }
+
+        if (mode->parse_mode == GPS_PARSE_IN_TASK)
+                NEO6_Process(&gps);
+
+        return back;
+}
+
+
+/**
+ * @brief Store little endian value to UBX payload
+ *
+*/
+static void replay_put32(uint8_t *payload, uint32_t value)
+{
+        for (uint8_t i = 0; i < 4; i++)
+                payload[i] = (uint8_t)(value >> (8 * i));
+}
+
+
+/**
+ * @brief Feed one UBX navigation epoch, the messages in the order the module sends them
+ *
+ * @retval 1 if speed, course or predictor velocity are not the ones of NAV-VELNED, 0 otherwise
+*/
+static int replay_ubx(void)
+{
+        uint8_t posllh[28] = { 0 };
+        uint8_t sol[52] = { 0 };
+        uint8_t velned[36] = { 0 };
+        uint8_t frame[64];
+        struct NEO6_Fix fix;
+
+        memset(&gps, 0, sizeof(gps));
+        NEO6_InitReplay(&gps);
+        NEO6_SetProtocol(&gps, GPS_PROTOCOL_UBX);
+
+        replay_put32(posllh, REPLAY_UBX_ITOW);
+        replay_put32(posllh + 4, 174000000UL); // lon 17.4 E
+        replay_put32(posllh + 8, 491000000UL); // lat 49.1 N
+        replay_put32(posllh + 16, 250000); // 250 m above sea level
+
+        replay_put32(sol, REPLAY_UBX_ITOW);
+        sol[10] = 0x03; // 3D fix
+        sol[11] = 0x01; // GPSfixOK
+        sol[44] = 150; // PDOP 1.5
+        sol[47] = 8;
+
+        replay_put32(velned, REPLAY_UBX_ITOW);
+        replay_put32(velned + 20, REPLAY_UBX_SPEED);
+        replay_put32(velned + 24, REPLAY_UBX_HEADING);
+
+        NEO6_ReceiveBuffer(&gps, (const char *)frame, UBX_BuildFrame(frame, UBX_CLASS_NAV, UBX_NAV_POSLLH, posllh, sizeof(posllh)));
+        NEO6_ReceiveBuffer(&gps, (const char *)frame, UBX_BuildFrame(frame, UBX_CLASS_NAV, UBX_NAV_SOL, sol, sizeof(sol)));
+
+        // position waits for the velocity of its epoch
+        if (NEO6_GetFix(&gps, &fix) != GPS_OK || fix.predict.valid)
+                return 1;
+
+        NEO6_ReceiveBuffer(&gps, (const char *)frame, UBX_BuildFrame(frame, UBX_CLASS_NAV, UBX_NAV_VELNED, velned, sizeof(velned)));
+
+        if (NEO6_GetFix(&gps, &fix) != GPS_OK)
+                return 1;
+
+        printf("ubx epoch: speed %u cm/s, course %u (0.01 deg), predictor %ld/%ld (1e-7 deg/s north/east)\n",
+               fix.info.speed, fix.info.course, (long)fix.predict.v_lat, (long)fix.predict.v_lon);
+
+        return (fix.info.pos.lat != 491000000L || fix.info.speed != REPLAY_UBX_SPEED ||
+                fix.info.course != REPLAY_UBX_HEADING / 1000 || !fix.predict.valid ||
+                fix.predict.v_lat <= 0 || fix.predict.v_lon <= 0);
+}
+
+
+static double replay_seconds(void)
+{
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+
+/**
+ * @brief Feed the log to NEO6_ReceiveBuffer(...) in blocks of given size, passes times
+ *
+ * @retval sentences/s
+*/
+static double replay_buffer(const struct replay_log *log, long passes, uint16_t block)
+{
+        struct NEO6_Health health;
+        double seconds;
+
+        memset(&gps, 0, sizeof(gps));
+        NEO6_InitReplay(&gps);
+
+        seconds = replay_seconds();
+        for (long p = 0; p < passes; p++) {
+                for (uint32_t i = 0; i < log->len; i += block) {
+                        uint32_t len = log->len - i;
+
+                        NEO6_ReceiveBuffer(&gps, log->data + i, (len < block) ? len : block);
+                }
+        }
+        seconds = replay_seconds() - seconds;
+
+        NEO6_GetHealth(&gps, &health);
+
+        return (seconds > 0) ? health.accepted / seconds : 0.0;
+}
+
+
+static int replay_compare(const void *a, const void *b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+
+        return (x > y) - (x < y);
+}
+
+
+static double replay_median(double *values, uint8_t count)
+{
+        qsort(values, count, sizeof(values[0]), replay_compare);
+
+        return values[count / 2];
+}
+
+
+int main(int argc, char *argv[])
+{
+        static struct replay_log log;
+        static struct replay_latency lat;
+        struct NEO6_ParsedInfo reference;
+        struct NEO6_Health reference_health;
+        int failed = 0;
+        const char *path = (argc > 1) ? argv[1] : REPLAY_DEFAULT_LOG;
+        long passes = (argc > 2) ? strtol(argv[2], NULL, 10) : REPLAY_DEFAULT_PASSES;
+
+        if (replay_load(&log, path) != 0) {
+                fprintf(stderr, "cannot read %s\n", path);
+                return 2;
+        }
+
+        if (passes < 1)
+                passes = 1;
+
+        printf("log %s: %u bytes, %u epochs with fix, %ld passes\n", path, log.len, log.epochs, passes);
+
+        for (uint8_t m = 0; m < REPLAY_MODES; m++) {
+                const struct replay_mode *mode = &replay_modes[m];
+                struct NEO6_Health health;
+                uint32_t sentences;
+                uint64_t cycles;
+                double seconds;
+
+                // one pass to check the result, then timed passes
+                replay_init(mode);
+                replay_pass(mode, &log);
+
+                if (m == 0)
+                        reference = gps.info;
+                else if (memcmp(&reference, &gps.info, sizeof(reference)) != 0) {
+                        printf("%-14s info differs from %s\n", mode->name, replay_modes[0].name);
+                        failed = 1;
+                }
+
+                if (!gps.info.quality) {
+                        printf("%-14s no fix at the end of the log\n", mode->name);
+                        failed = 1;
+                }
+
+                replay_init(mode);
+                NEO6_GetHealth(&gps, &health);
+
+                seconds = replay_seconds();
+                cycles = host_cycles();
+                for (long p = 0; p < passes; p++)
+                        replay_pass(mode, &log);
+                cycles = host_cycles() - cycles;
+                seconds = replay_seconds() - seconds;
+
+                NEO6_GetHealth(&gps, &health);
+                sentences = health.accepted + health.rejected + health.overflowed;
+
+                if (m == 0)
+                        reference_health = health;
+                else if (health.accepted != reference_health.accepted || health.rejected != reference_health.rejected ||
+                         health.overflowed != reference_health.overflowed) {
+                        printf("%-14s sentence counts differ from %s\n", mode->name, replay_modes[0].name);
+                        failed = 1;
+                }
+
+                replay_latency(mode, &log, &lat);
+
+                printf("%-14s %9.0f sentences/s  %6.0f cycles/sentence  calc cycles %lu/%lu/%lu  "
+                       "accepted %lu rejected %lu overflowed %lu\n",
+                       mode->name, seconds > 0 ? health.accepted / seconds : 0.0,
+                       sentences ? (double)cycles / sentences : 0.0,
+                       (unsigned long)health.cycles_min, (unsigned long)health.cycles_avg, (unsigned long)health.cycles_max,
+                       (unsigned long)health.accepted, (unsigned long)health.rejected, (unsigned long)health.overflowed);
+
+                if (lat.fixes) {
+                        printf("%-14s fix latency: %lu fixes, %llu/%llu/%llu cycles min/avg/max, %.1f ms on the wire at %u baud\n",
+                               mode->name, (unsigned long)lat.fixes, (unsigned long long)lat.cycles_min,
+                               (unsigned long long)(lat.cycles_total / lat.fixes), (unsigned long long)lat.cycles_max,
+                               (double)lat.bytes_total / lat.fixes * 10 * 1000 / REPLAY_BAUDRATE, REPLAY_BAUDRATE);
+                }
+                else {
+                        printf("%-14s fix latency: no fix\n", mode->name);
+                        failed = 1;
+                }
+        }
+
+        for (uint8_t m = 0; m < REPLAY_MODES; m++) {
+                const struct replay_mode *mode = &replay_modes[m];
+                struct NEO6_Health health;
+
+                if (mode->rx_mode != GPS_RX_MODE_DMA)
+                        continue;
+
+                if (replay_error(mode, &log)) {
+                        printf("%-14s fix time went back after UART error\n", mode->name);
+                        failed = 1;
+                }
+
+                NEO6_GetHealth(&gps, &health);
+                printf("%-14s UART error: accepted %lu rejected %lu overflowed %lu uart errors %lu\n", mode->name,
+                       (unsigned long)health.accepted, (unsigned long)health.rejected, (unsigned long)health.overflowed,
+                       (unsigned long)health.uart_errors);
+
+                if (mode->parse_mode == GPS_PARSE_IN_ISR)
+                        reference_health = health;
+                else if (health.accepted != reference_health.accepted || health.rejected != reference_health.rejected) {
+                        printf("%-14s sentence counts after UART error differ from ISR parsing\n", mode->name);
+                        failed = 1;
+                }
+        }
+
+        if (replay_ubx()) {
+                printf("ubx epoch: speed and course are not the ones of NAV-VELNED\n");
+                failed = 1;
+        }
+
+        {
+                struct NEO6_ParsedInfo by_char;
+                double char_rates[REPLAY_REPEAT];
+                double block_rates[REPLAY_REPEAT];
+                double char_rate;
+                double block_rate;
+
+                // alternate both so that both see the same host load
+                for (uint8_t r = 0; r < REPLAY_REPEAT; r++) {
+                        char_rates[r] = replay_buffer(&log, passes, 1);
+                        by_char = gps.info;
+                        block_rates[r] = replay_buffer(&log, passes, REPLAY_BLOCK);
+                }
+
+                char_rate = replay_median(char_rates, REPLAY_REPEAT);
+                block_rate = replay_median(block_rates, REPLAY_REPEAT);
+
+                printf("buffer char by char %9.0f sentences/s, blocks of %u %9.0f sentences/s, %.2fx\n",
+                       char_rate, REPLAY_BLOCK, block_rate, char_rate > 0 ? block_rate / char_rate : 0.0);
+
+                if (memcmp(&by_char, &gps.info, sizeof(by_char)) != 0 || memcmp(&reference, &gps.info, sizeof(reference)) != 0) {
+                        printf("buffer info differs from %s\n", replay_modes[0].name);
+                        failed = 1;
+                }
+        }
+
+        printf("%s\n", failed ? "FAILED" : "OK");
+
+        return failed;
+}
@@ -0,0 +1,254 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+
+#include "neo6.h"
+
+/**
+ * Warm start against a simulated receiver
+ *
+ * Usage: neo6_warm_test [log]
+ *
+ * The receiver is the host_uart_tx hook: UBX frames sent by the library are checked
+ *  and recorded, AID-EPH poll is answered with UBX_AID_EPH_COUNT AID-EPH frames
+ *  (ephemeris for WARM_TEST_EPH of them) received char by char amid NMEA output.
+ *  Flash page at GPS_WARM_FLASH_ADDR is mapped by host_flash_init().
+ *
+ * Built with GPS_WARM_START and GPS_WARM_UTC_NOW = warm_test_utc_now, so
+ *  NEO6_Init(...) sends the stored data with the time set by the test
+ *
+ * Exits with 1 if a check fails
+ *
+*/
+
+#define WARM_TEST_DEFAULT_LOG "data/flight.nmea"
+#define WARM_TEST_FIX_CHARS 8192 // chars of the log received before warm start data is collected
+#define WARM_TEST_EPH 3 // satellites with ephemeris in the poll response
+
+#define WARM_TEST_CHECK(condition) warm_test_check((condition), #condition, __LINE__)
+
+/**
+ * UBX frames received by the simulated receiver since warm_test_boot()
+ *
+*/
+struct warm_test_rx {
+        uint8_t ini_count;
+        uint8_t ini[48];
+        uint8_t eph_count;
+        uint8_t eph[GPS_WARM_MAX_EPH][UBX_AID_EPH_SIZE];
+        uint8_t polls;
+        uint8_t bad_frames;
+};
+
+static struct NEO6 gps;
+static UART_HandleTypeDef huart;
+static struct warm_test_rx rx;
+static uint32_t utc_now;
+static int failed;
+
+uint32_t warm_test_utc_now(void);
+
+
+/**
+ * @brief Time of GPS_WARM_UTC_NOW() (RTC on the target)
+ *
+*/
+uint32_t warm_test_utc_now(void)
+{
+        return utc_now;
+}
+
+
+static void warm_test_check(int condition, const char *text, int line)
+{
+        if (!condition) {
+                printf("line %d: check failed: %s\n", line, text);
+                failed = 1;
+        }
+}
+
+
+static uint32_t warm_test_get32(const uint8_t *payload)
+{
+        return payload[0] | (payload[1] << 8) | (payload[2] << 16) | ((uint32_t)payload[3] << 24);
+}
+
+
+/**
+ * @brief Receive chars from the module, as UART interrupt does
+ *
+*/
+static void warm_test_receive(const uint8_t *data, uint16_t size)
+{
+        for (uint16_t i = 0; i < size; i++) {
+                gps.com.rx_char = data[i];
+                NEO6_UART_RxCpltCallback(&huart);
+        }
+}
+
+
+/**
+ * @brief Simulated receiver: record UBX frames sent by the library, answer AID-EPH poll
+ *
+*/
+static void warm_test_module(UART_HandleTypeDef *uart, const uint8_t *data, uint16_t size)
+{
+        const char *nmea = "$GPTXT,01,01,02,ANTENNA OK*36\r\n";
+        uint16_t length;
+        uint8_t ck_a = 0;
+        uint8_t ck_b = 0;
+
+        if (uart != &huart || size < UBX_FRAME_OVERHEAD || data[0] != UBX_SYNC_CHAR_1 || data[1] != UBX_SYNC_CHAR_2) {
+                rx.bad_frames++;
+                return ;
+        }
+
+        length = data[4] | (data[5] << 8);
+        for (uint16_t i = 2; i < size - 2; i++) {
+                ck_a += data[i];
+                ck_b += ck_a;
+        }
+
+        if (size != length + UBX_FRAME_OVERHEAD || data[size - 2] != ck_a || data[size - 1] != ck_b) {
+                rx.bad_frames++;
+                return ;
+        }
+
+        if (data[2] != UBX_CLASS_AID)
+                return ;
+
+        if (data[3] == UBX_AID_INI && length == sizeof(rx.ini)) {
+                memcpy(rx.ini, data + 6, sizeof(rx.ini));
+                rx.ini_count++;
+        }
+        else if (data[3] == UBX_AID_EPH && length == UBX_AID_EPH_SIZE) {
+                if (rx.eph_count < GPS_WARM_MAX_EPH)
+                        memcpy(rx.eph[rx.eph_count], data + 6, UBX_AID_EPH_SIZE);
+                rx.eph_count++;
+        }
+        else if (data[3] == UBX_AID_EPH && length == 0) {
+                rx.polls++;
+
+                // one response per satellite, ephemeris (104 bytes) only for the first ones
+                for (uint8_t sv = 1; sv <= UBX_AID_EPH_COUNT; sv++) {
+                        uint8_t payload[UBX_AID_EPH_SIZE] = { sv };
+                        uint8_t frame[UBX_AID_EPH_SIZE + UBX_FRAME_OVERHEAD];
+                        uint16_t eph_size = (sv <= WARM_TEST_EPH) ? UBX_AID_EPH_SIZE : 8;
+
+                        for (uint8_t i = 8; i < eph_size; i++)
+                                payload[i] = (uint8_t)(sv * 31 + i);
+
+                        warm_test_receive(frame, UBX_BuildFrame(frame, UBX_CLASS_AID, UBX_AID_EPH, payload, eph_size));
+                        warm_test_receive((const uint8_t *)nmea, (uint16_t)strlen(nmea));
+                }
+        }
+}
+
+
+/**
+ * @brief Reset after which the module gets warm start data from flash (NEO6_Init)
+ *
+*/
+static void warm_test_boot(uint32_t time)
+{
+        memset(&rx, 0, sizeof(rx));
+        memset(&gps, 0, sizeof(gps));
+        utc_now = time;
+
+        WARM_TEST_CHECK(NEO6_Init(&gps, &huart) == HAL_OK);
+        WARM_TEST_CHECK(rx.bad_frames == 0);
+}
+
+
+int main(int argc, char *argv[])
+{
+        static struct NEO6_WarmData data;
+        const struct NEO6_WarmData *stored = (const struct NEO6_WarmData *)GPS_WARM_FLASH_ADDR;
+        const char *path = (argc > 1) ? argv[1] : WARM_TEST_DEFAULT_LOG;
+        static uint8_t log[WARM_TEST_FIX_CHARS];
+        struct NEO6_Fix fix;
+        uint32_t gps_time;
+        uint32_t rejected;
+        uint16_t len;
+        FILE *file;
+
+        if (host_flash_init() != 0) {
+                fprintf(stderr, "cannot map flash page at 0x%08lX\n", (unsigned long)GPS_WARM_FLASH_ADDR);
+                return 2;
+        }
+
+        file = fopen(path, "rb");
+        if (file == NULL) {
+                fprintf(stderr, "cannot read %s\n", path);
+                return 2;
+        }
+        len = (uint16_t)fread(log, 1, sizeof(log), file);
+        fclose(file);
+
+        // module sends UBX responses between sentences
+        while (len && log[len - 1] != '\n')
+                len--;
+
+        huart.Init.BaudRate = 9600;
+        host_uart_tx = warm_test_module;
+
+        // erased page: nothing is sent at boot
+        warm_test_boot(0);
+        WARM_TEST_CHECK(rx.ini_count == 0 && rx.eph_count == 0);
+        WARM_TEST_CHECK(NEO6_WarmCollect(&gps, &data) == GPS_MESSAGE_INVALID);
+
+        // collect with fix, ephemerides come from the poll
+        warm_test_receive(log, len);
+        WARM_TEST_CHECK(NEO6_GetFix(&gps, &fix) == GPS_OK && fix.info.quality);
+        rejected = gps.stats.rejected;
+        WARM_TEST_CHECK(NEO6_WarmCollect(&gps, &data) == GPS_OK);
+        WARM_TEST_CHECK(rx.polls == 1);
+        WARM_TEST_CHECK(data.eph_count == WARM_TEST_EPH);
+        WARM_TEST_CHECK(data.utc_time == fix.info.utc_time);
+        WARM_TEST_CHECK(data.lat == ((fix.info.pos.lat_dir == 'S') ? -fix.info.pos.lat : fix.info.pos.lat));
+        WARM_TEST_CHECK(data.lon == ((fix.info.pos.lon_dir == 'W') ? -fix.info.pos.lon : fix.info.pos.lon));
+        WARM_TEST_CHECK(gps.com.warm == NULL);
+        WARM_TEST_CHECK(gps.stats.rejected == rejected);
+
+        WARM_TEST_CHECK(NEO6_WarmSave(&data) == HAL_OK);
+        WARM_TEST_CHECK(NEO6_WarmValid(stored) == GPS_OK);
+        WARM_TEST_CHECK(memcmp(stored, &data, sizeof(data)) == 0);
+
+        // same data is not written again (programming a written word fails)
+        WARM_TEST_CHECK(NEO6_WarmSave(&data) == GPS_OK);
+
+        // time unknown: position only, ephemerides of unknown age are not sent
+        warm_test_boot(0);
+        WARM_TEST_CHECK(rx.ini_count == 1);
+        WARM_TEST_CHECK(warm_test_get32(rx.ini + 44) == (0x01 | 0x20));
+        WARM_TEST_CHECK((int32_t)warm_test_get32(rx.ini + 0) == data.lat);
+        WARM_TEST_CHECK((int32_t)warm_test_get32(rx.ini + 4) == data.lon);
+        WARM_TEST_CHECK(rx.eph_count == 0);
+
+        // time known, ephemerides 10 minutes old: time and all ephemerides are sent
+        warm_test_boot(data.utc_time + 600);
+        gps_time = utc_now - 315964800UL + GPS_LEAP_SECONDS;
+        WARM_TEST_CHECK(rx.ini_count == 1);
+        WARM_TEST_CHECK(warm_test_get32(rx.ini + 44) == (0x01 | 0x02 | 0x20));
+        WARM_TEST_CHECK((uint32_t)(rx.ini[18] | (rx.ini[19] << 8)) == gps_time / 604800);
+        WARM_TEST_CHECK(warm_test_get32(rx.ini + 20) == (gps_time % 604800) * 1000);
+        WARM_TEST_CHECK(rx.eph_count == WARM_TEST_EPH);
+        WARM_TEST_CHECK(memcmp(rx.eph, data.eph, WARM_TEST_EPH * UBX_AID_EPH_SIZE) == 0);
+
+        // ephemerides too old, or time before the fix (wrong RTC): position and time only
+        warm_test_boot(data.utc_time + GPS_WARM_MAX_AGE + 1);
+        WARM_TEST_CHECK(rx.ini_count == 1 && rx.eph_count == 0);
+        warm_test_boot(data.utc_time - 1);
+        WARM_TEST_CHECK(rx.ini_count == 1 && rx.eph_count == 0);
+
+        // damaged page: nothing is sent
+        ((uint8_t *)GPS_WARM_FLASH_ADDR)[100] ^= 0x01;
+        warm_test_boot(data.utc_time + 600);
+        WARM_TEST_CHECK(rx.ini_count == 0 && rx.eph_count == 0);
+
+        printf("warm start: %u ephemerides stored, %s\n", data.eph_count, failed ? "FAILED" : "OK");
+
+        return failed;
+}